@@ -15,6 +15,7 @@ static std::string g_log_level;
 static std::string g_config_file;
 static bool        g_use_stdin;
 static std::string g_output_file;
+static std::string g_compile_output_file;
 static bedrock::ConfigType g_config_type = bedrock::ConfigType::JSON;
 static std::string g_jx9_params;
 
@@ -33,6 +34,17 @@ int main(int argc, char** argv) {
         else if (!g_config_file.empty())
             config = getConfigFromFile(g_config_file);
         auto jx9_params = parseJx9Params(g_jx9_params);
+        if (!g_compile_output_file.empty()) {
+            auto compiled = bedrock::Server::compileConfig(config, g_config_type, jx9_params);
+            std::ofstream output_file(g_compile_output_file, std::ios::binary);
+            output_file.write(compiled.data(), compiled.size());
+            if (!output_file.good()) {
+                std::cerr << "error: could not write compiled configuration to "
+                          << g_compile_output_file << std::endl;
+                return -1;
+            }
+            return 0;
+        }
         bedrock::Server server(g_address, config, g_config_type, jx9_params);
         if (!g_output_file.empty()) {
             std::ofstream output_file(g_output_file);
@@ -87,6 +99,13 @@ static void parseCommandLine(int argc, char** argv) {
             "j", "jx9", "Interpret configuration as a Jx9 script", false);
         TCLAP::SwitchArg tomlSwitch(
             "t", "toml", "Configuration is in TOML format instead of JSON", false);
+        TCLAP::SwitchArg compiledSwitch(
+            "", "compiled", "Configuration was produced by --compile-config", false);
+        TCLAP::ValueArg<std::string> compileConfigFile(
+            "", "compile-config",
+            "Resolve and validate the configuration, write it in binary form "
+            "to the given file (to be used with --compiled), and exit",
+            false, "", "output-file");
         TCLAP::ValueArg<std::string> jx9Params(
             "", "jx9-context", "Comma-separated list of Jx9 parameters for the Jx9 script",
             false, "", "x=1,y=2,z=something,...");
@@ -98,6 +117,8 @@ static void parseCommandLine(int argc, char** argv) {
         cmd.add(jx9Switch);
         cmd.add(jx9Params);
         cmd.add(tomlSwitch);
+        cmd.add(compiledSwitch);
+        cmd.add(compileConfigFile);
         cmd.parse(argc, argv);
         g_address     = address.getValue();
         g_log_level   = logLevel.getValue();
@@ -105,6 +126,7 @@ static void parseCommandLine(int argc, char** argv) {
         g_output_file = outConfigFile.getValue();
         g_use_stdin   = stdinSwitch.getValue();
         g_jx9_params  = jx9Params.getValue();
+        g_compile_output_file = compileConfigFile.getValue();
         if (g_use_stdin && configFile.isSet()) {
             std::cerr << "error: both config file and --stdin were provided"
                       << std::endl;
@@ -124,6 +146,19 @@ static void parseCommandLine(int argc, char** argv) {
         if (tomlSwitch.getValue()) {
             g_config_type = bedrock::ConfigType::TOML;
         }
+        if (compiledSwitch.getValue()) {
+            if (jx9Switch.getValue() || tomlSwitch.getValue()) {
+                std::cerr << "error: cannot use --compiled with --jx9/-j or --toml/-t"
+                          << std::endl;
+                exit(-1);
+            }
+            if (compileConfigFile.isSet()) {
+                std::cerr << "error: cannot use both --compiled and --compile-config"
+                          << std::endl;
+                exit(-1);
+            }
+            g_config_type = bedrock::ConfigType::COMPILED;
+        }
     } catch (TCLAP::ArgException& e) {
         std::cerr << "error: " << e.error() << " for arg " << e.argId()
                   << std::endl;
@@ -139,7 +174,7 @@ static std::string getConfigFromStdIn() {
 }
 
 static std::string getConfigFromFile(const std::string& filename) {
-    std::ifstream t(filename.c_str());
+    std::ifstream t(filename.c_str(), std::ios::binary);
     if(!t.good()) {
         std::cerr << "error: could not read configuration file " << filename << std::endl;
         exit(-1);
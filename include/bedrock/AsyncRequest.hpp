@@ -6,14 +6,19 @@
 #ifndef __BEDROCK_ASYNC_REQUEST_HPP
 #define __BEDROCK_ASYNC_REQUEST_HPP
 
+#include <thallium.hpp>
+#include <functional>
+#include <future>
 #include <memory>
 #include <string>
+#include <vector>
 
 namespace bedrock {
 
 class AsyncRequestImpl;
 class ServiceHandle;
 class ServiceGroupHandle;
+class Exception;
 
 /**
  * @brief AsyncRequest objects are used to keep track of
@@ -78,6 +83,57 @@ class AsyncRequest {
      */
     operator bool() const;
 
+    /**
+     * @brief Registers a callback to invoke once the request completes,
+     * instead of waiting for it. The callback is invoked in a ULT of the
+     * provided pool after the request's results have been written to
+     * their destinations, with a pointer to the error if the operation
+     * failed, nullptr otherwise. A single ULT per pool polls all the
+     * requests registered for this pool, so no ULT is blocked per request.
+     * It backs off between polls, so callbacks of slow requests may be
+     * invoked up to 1ms after the request completes.
+     *
+     * The AsyncRequest is consumed by this call and becomes invalid.
+     * The destinations of the results must remain valid until the
+     * callback is invoked.
+     *
+     * @param callback Callback to invoke.
+     * @param pool Pool in which to invoke the callback.
+     */
+    void then(std::function<void(const Exception* error)> callback,
+              const thallium::pool& pool);
+
+    /**
+     * @brief Returns a std::future that becomes ready when the request
+     * completes, and holds its error if it failed. This is built on top
+     * of then(), hence the pool argument. The future should not be
+     * waited on from a ULT running on an execution stream that pulls
+     * from this pool, since std::future blocks the whole stream.
+     *
+     * The AsyncRequest is consumed by this call and becomes invalid.
+     *
+     * @param pool Pool in which to complete the future.
+     */
+    std::future<void> toFuture(const thallium::pool& pool);
+
+    /**
+     * @brief Waits for any of the active requests in the list to complete
+     * and returns its index after calling wait() on it (which will throw
+     * if the request failed). Returns reqs.size() if none of the requests
+     * is active. This function polls the requests, yielding then sleeping
+     * for increasing durations (up to 1ms) in between.
+     */
+    static size_t waitAny(const std::vector<AsyncRequest>& reqs);
+
+    /**
+     * @brief Waits for at least one of the active requests in the list to
+     * complete, then calls wait() on all the requests that have completed
+     * and returns their indices. If some of them failed, the exception
+     * of the first one is thrown after all of them have been waited on.
+     * Returns an empty vector if none of the requests is active.
+     */
+    static std::vector<size_t> waitSome(const std::vector<AsyncRequest>& reqs);
+
   private:
     std::shared_ptr<AsyncRequestImpl> self;
 
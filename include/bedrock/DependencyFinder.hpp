@@ -11,6 +11,7 @@
 #include <bedrock/MPIEnv.hpp>
 #include <string>
 #include <memory>
+#include <vector>
 
 namespace bedrock {
 
@@ -104,6 +105,21 @@ class DependencyFinder {
              const std::string& spec,
              std::string* resolved) const;
 
+    /**
+     * @brief Resolve remote provider specifications (i.e. of the form
+     * "name@locator" or "type:id@locator") ahead of time. The specifications
+     * are grouped by destination and a single bedrock_lookup_providers RPC
+     * is sent to each destination, all destinations being contacted
+     * concurrently. Subsequent calls to find() for these specifications
+     * are then answered without a remote lookup.
+     *
+     * Specifications that are not remote or that cannot be resolved
+     * are ignored; find() will report the error when called on them.
+     *
+     * @param specs Dependency specifications.
+     */
+    void prefetch(const std::vector<std::string>& specs) const;
+
     /**
      * @brief Find a dependency by an "index" value. The dependency
      * should be a pool or an xstream
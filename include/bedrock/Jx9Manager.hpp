@@ -11,6 +11,7 @@
 #include <unordered_map>
 #include <memory>
 #include <bedrock/MPIEnv.hpp>
+#include <nlohmann/json.hpp>
 
 namespace bedrock {
 
@@ -86,6 +87,9 @@ class Jx9Manager {
      * In case of a Jx9 error, this function will throw
      * an Exception.
      *
+     * Concurrent calls run in parallel, each using its own
+     * Jx9 engine.
+     *
      * @param script Content of the script to execute.
      * @param variables variables to add to the jx9 VM.
      *
@@ -95,6 +99,21 @@ class Jx9Manager {
         const std::string&                                  script,
         const std::unordered_map<std::string, std::string>& variables) const;
 
+    /**
+     * @brief Same as above but the variables are provided as JSON
+     * values, which avoids serializing them only to have them parsed
+     * back. Variables whose name does not appear in the script are
+     * not converted into Jx9 values.
+     *
+     * @param script Content of the script to execute.
+     * @param variables variables to add to the jx9 VM.
+     *
+     * @return The serialized returned value of the script.
+     */
+    std::string executeQuery(
+        const std::string&                                     script,
+        const std::unordered_map<std::string, nlohmann::json>& variables) const;
+
     /**
      * @brief Evaluate a condition written in Jx9.
      */
@@ -102,9 +121,29 @@ class Jx9Manager {
         const std::string&                                  condition,
         const std::unordered_map<std::string, std::string>& variables) const;
 
+    /**
+     * @brief Evaluate a list of conditions written in Jx9 using a single
+     * execution of the Jx9 VM. The returned vector contains the result
+     * of each condition, in the same order. If any condition fails to
+     * compile or execute, this function throws the same exception as
+     * evaluateCondition would for that condition.
+     */
+    std::vector<bool> evaluateConditions(
+        const std::vector<std::string>&                     conditions,
+        const std::unordered_map<std::string, std::string>& variables) const;
+
   private:
     std::shared_ptr<Jx9ManagerImpl> self;
 
+    /**
+     * @brief Implementation of executeQuery. Variables are passed by
+     * pointer so that large values (e.g. the server's configuration)
+     * are provided to the VM without being copied.
+     */
+    std::string executeQuery(
+        const std::string&                                           script,
+        const std::unordered_map<std::string, const nlohmann::json*>& variables) const;
+
     inline operator std::shared_ptr<Jx9ManagerImpl>() const { return self; }
 
     inline Jx9Manager(std::shared_ptr<Jx9ManagerImpl> impl)
@@ -19,6 +19,7 @@ class MPIEnv {
 
     friend class Server;
     friend class DependencyFinder;
+    friend class Jx9ManagerImpl;
 
   public:
 
@@ -9,9 +9,11 @@
 #include <bedrock/NamedDependency.hpp>
 #include <bedrock/ProviderDescriptor.hpp>
 #include <bedrock/MargoManager.hpp>
+#include <bedrock/RequestResult.hpp>
 #include <nlohmann/json.hpp>
 #include <string>
 #include <memory>
+#include <vector>
 
 namespace bedrock {
 
@@ -164,6 +166,31 @@ class ProviderManager {
      */
     void addProviderListFromJSON(const json& list);
 
+    /**
+     * @brief Same as above, but the dependencies sections of the entries
+     * are used to build a dependency graph and providers that do not
+     * depend on one another are instantiated concurrently, as ULTs
+     * in the provided pool, one topological wave at a time.
+     * Provider IDs, the order of the providers, and the error reported
+     * in case of failure are the same as when instantiating them one
+     * after the other. Lists for which the graph cannot be determined
+     * statically (e.g. forward references) are instantiated sequentially.
+     *
+     * If an entry fails, entries of the same wave that come after it in
+     * the list may have been instantiated concurrently with it. These are
+     * removed before the error is reported, so the providers that remain
+     * are the ones sequential instantiation would have left, but their
+     * registration and deregistration did run (and they may have been
+     * looked up in the meantime). The configuration generation seen by
+     * ServiceHandle::getConfigSince is not changed by such rolled back
+     * providers.
+     *
+     * @param list JSON array.
+     * @param pool Pool in which to instantiate providers concurrently.
+     */
+    void addProviderListFromJSON(const json& list,
+                                 std::shared_ptr<NamedDependency> pool);
+
     /**
      * @brief Migrates the specified provider state to the destination.
      *
@@ -213,9 +240,43 @@ class ProviderManager {
      */
     json getCurrentConfig() const;
 
+    /**
+     * @brief Notifies the ProviderManager that the configuration of a
+     * provider changed without going through it (e.g. a provider changed
+     * its own configuration), or that modules were loaded directly through
+     * the ModuleManager, so that the configuration reported to clients is
+     * rebuilt. Without this call, such changes are only picked up once the
+     * cached configuration expires (see "config_cache_ttl").
+     */
+    void invalidateConfig();
+
   private:
     std::shared_ptr<ProviderManagerImpl> self;
 
+    /**
+     * @brief Implementation of addProviderFromJSON. Provider descriptions
+     * are not validated if validated is true (e.g. when they come from
+     * a compiled configuration).
+     */
+    std::shared_ptr<ProviderDependency>
+        createProvider(const json& description, bool validated);
+
+    /**
+     * @brief Implementation of addProviderListFromJSON.
+     */
+    void createProviderList(const json& list,
+                            std::shared_ptr<NamedDependency> pool,
+                            bool validated);
+
+    /**
+     * @brief Adds a batch of providers sent by a client (bedrock_start_providers
+     * RPC). Unlike addProviderListFromJSON, the providers are added
+     * independently: the failure of one of them does not prevent the
+     * next ones from being added, and the result of each is returned.
+     * The remote dependencies of the whole batch are resolved upfront.
+     */
+    std::vector<RequestResult<uint16_t>> createProviderBatch(const json& list);
+
     inline operator std::shared_ptr<ProviderManagerImpl>() const {
         return self;
     }
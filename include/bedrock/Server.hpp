@@ -24,7 +24,8 @@ class ServerImpl;
 enum class ConfigType {
     JSON,
     JX9,
-    TOML
+    TOML,
+    COMPILED /* produced by Server::compileConfig */
 };
 
 /**
@@ -44,14 +45,33 @@ class Server {
      * @brief Constructor.
      *
      * @param address Address of the server.
-     * @param config JSON or JX9 configuration script.
-     * @param configType type of configuration (JSON or JX9).
+     * @param config JSON, JX9, TOML, or compiled configuration.
+     * @param configType type of configuration.
      * @param jx9Params parameters to pass to Jx9 configuration.
      */
     Server(const std::string& address, const std::string& config = "",
            ConfigType configType = ConfigType::JSON,
            const Jx9ParamMap& jx9Params = Jx9ParamMap());
 
+    /**
+     * @brief Resolves a configuration (running Jx9, parsing JSON or TOML,
+     * expanding simplified keys and filtering __if__ conditions) and
+     * validates its provider descriptions, returning a binary (CBOR)
+     * configuration that a Server can be created from with
+     * ConfigType::COMPILED, skipping these steps. Configurations
+     * resolving to an array (one entry per MPI rank) stay arrays,
+     * and the entry of each rank is selected when the Server is created.
+     *
+     * @param config JSON, JX9, or TOML configuration.
+     * @param configType type of configuration.
+     * @param jx9Params parameters to pass to Jx9 configuration.
+     *
+     * @return the compiled configuration.
+     */
+    static std::string compileConfig(const std::string& config,
+                                     ConfigType configType = ConfigType::JSON,
+                                     const Jx9ParamMap& jx9Params = Jx9ParamMap());
+
     /**
      * @brief Copy-constructor is deleted.
      */
@@ -102,6 +122,16 @@ class Server {
      */
     std::string getCurrentConfig() const;
 
+    /**
+     * @brief Return a JSON report of the time spent in each step of the
+     * server's construction (phases, loading of each module, dependency
+     * resolution and construction of each provider). If the "bedrock"
+     * section of the configuration has a "startup_trace" entry, the
+     * report is also written to this file in the Chrome trace-event
+     * format.
+     */
+    std::string getStartupReport() const;
+
   private:
     std::unique_ptr<ServerImpl> self;
 
@@ -10,6 +10,7 @@
 #include <bedrock/Exception.hpp>
 #include <bedrock/AsyncRequest.hpp>
 #include <bedrock/DependencyMap.hpp>
+#include <bedrock/RequestResult.hpp>
 
 #include <thallium.hpp>
 #include <nlohmann/json.hpp>
@@ -87,6 +88,42 @@ class ServiceGroupHandle {
      */
     ServiceHandle operator[](size_t i) const;
 
+    /**
+     * @brief Makes getConfig and queryConfig propagate along a k-ary tree
+     * of the service processes instead of sending one RPC to each of them:
+     * the client only contacts the first process, each process forwards
+     * the operation to at most k others and merges their results into its
+     * response. This bounds the number of RPCs handled by the client, and
+     * the latency grows with log(size()) rather than size(). The result is
+     * the same JSON object as without a tree (though its keys may not be
+     * sorted). A fanout of 0 (the default) disables the tree.
+     *
+     * Each process that forwards the operation keeps the ULT handling it
+     * until its children respond, or until "collective_timeout" seconds
+     * (from the "bedrock" section of the configuration, 30 by default) per
+     * level of the child's subtree have passed. Such ULTs yield while
+     * waiting, but the Bedrock pool of the service processes should be
+     * able to hold one of them per concurrent tree operation in addition
+     * to the ULTs handling other Bedrock RPCs.
+     *
+     * @param k Fanout of the tree.
+     */
+    void setTreeFanout(uint32_t k) const;
+
+    /**
+     * @brief Creates providers on all the service processes, sending
+     * each of them its own batch with ServiceHandle::addProviders.
+     * The RPCs are sent concurrently.
+     *
+     * @param descriptions JSON array of provider descriptions for each
+     * service process (the size of the vector must be size()).
+     * @param [out] results Result of each provider, for each process.
+     * @param req Asynchronous request to wait on, if provided.
+     */
+    void addProviders(const std::vector<nlohmann::json>&                  descriptions,
+                      std::vector<std::vector<RequestResult<uint16_t>>>* results = nullptr,
+                      AsyncRequest*                                       req = nullptr) const;
+
     /**
      * @brief Get the JSON configuration of a service process.
      *
@@ -95,6 +132,20 @@ class ServiceGroupHandle {
      */
     void getConfig(std::string* config, AsyncRequest* req = nullptr) const;
 
+    /**
+     * @brief Get the changes to the JSON configuration of each service
+     * process since a generation previously seen by the caller.
+     * The result is a JSON object mapping the address of each process
+     * to the changes, as returned by ServiceHandle::getConfigSince.
+     *
+     * @param [in] generations Last generation seen for each address
+     * (0 is used for addresses not in the map).
+     * @param [out] changes Resulting changes.
+     * @param [out] req Asynchronous request to wait on, if provided.
+     */
+    void getConfigSince(const std::unordered_map<std::string, uint64_t>& generations,
+                        std::string* changes, AsyncRequest* req = nullptr) const;
+
     /**
      * @brief Send a Jx9 script to be executed by the server.
      * In the Jx9 script, $__config__ represents the server's configuration.
@@ -107,6 +158,35 @@ class ServiceGroupHandle {
     void queryConfig(const std::string& script, std::string* result,
                      AsyncRequest* req = nullptr) const;
 
+    /**
+     * @brief Runs a map script on every service process and reduces the
+     * results on the service processes themselves, so that only the
+     * reduced value is sent back to the client. In the map script,
+     * $__config__ represents the server's configuration. The reduce script
+     * is called with $__values__ set to an array of two values and must
+     * return their reduction. Partial reductions are fed back to it, in an
+     * order that depends on the tree (see setTreeFanout), so it should be
+     * associative and commutative (e.g. a sum or a maximum).
+     *
+     * Without tree, the first process gathers and reduces the results
+     * of all the others as they arrive.
+     *
+     * Example counting the providers of type "yokan" in the group:
+     * map:    $n = 0;
+     *         foreach($__config__['providers'] as $p) { if($p['type'] == 'yokan') $n++; }
+     *         return $n;
+     * reduce: return $__values__[0] + $__values__[1];
+     *
+     * @param map_script Jx9 script run on each process.
+     * @param reduce_script Jx9 script reducing two values.
+     * @param result Reduced value.
+     * @param req Asynchronous request to wait on, if provided.
+     */
+    void mapReduceConfig(const std::string& map_script,
+                         const std::string& reduce_script,
+                         std::string* result,
+                         AsyncRequest* req = nullptr) const;
+
     /**
      * @brief Checks if the ServiceGroupHandle instance is valid.
      */
@@ -10,6 +10,7 @@
 #include <bedrock/Exception.hpp>
 #include <bedrock/AsyncRequest.hpp>
 #include <bedrock/DependencyMap.hpp>
+#include <bedrock/RequestResult.hpp>
 
 #include <thallium.hpp>
 #include <nlohmann/json.hpp>
@@ -96,6 +97,22 @@ class ServiceHandle {
                      uint16_t*          provider_id_out = nullptr,
                      AsyncRequest*      req = nullptr) const;
 
+    /**
+     * @brief Creates a batch of providers with a single RPC.
+     * The providers are created in order and independently of one
+     * another: the failure of one of them does not prevent the next
+     * ones from being created. The result of each provider (its
+     * provider ID or the error that prevented its creation) is
+     * stored in results. An Exception is only thrown if the
+     * RPC itself fails.
+     *
+     * @param descriptions JSON array of provider descriptions.
+     * @param [out] results Result of each provider.
+     * @param req Asynchronous request to wait on, if provided.
+     */
+    void addProviders(const nlohmann::json&                 descriptions,
+                      std::vector<RequestResult<uint16_t>>* results = nullptr,
+                      AsyncRequest*                         req = nullptr) const;
 
     /**
      * @brief Request that a provider change its pool for another one.
@@ -218,6 +235,34 @@ class ServiceHandle {
      */
     void getConfig(std::string* config, AsyncRequest* req = nullptr) const;
 
+    /**
+     * @brief Same as getConfig but returns the configuration as a JSON
+     * document. The configuration is transferred in a binary encoding
+     * (CBOR) if the service supports it, avoiding the cost of
+     * serializing and parsing it as text.
+     *
+     * @param [out] config Resulting configuration.
+     * @param [out] req Asynchronous request to wait on, if provided.
+     */
+    void getConfigJSON(nlohmann::json* config, AsyncRequest* req = nullptr) const;
+
+    /**
+     * @brief Get the changes to the JSON configuration of a service
+     * process since a generation of it previously seen by the caller.
+     * The result is a JSON object with a "generation" field (the current
+     * generation, to pass to the next call) and either "unchanged":true,
+     * a "patch" field containing a JSON Patch (RFC 6902) to apply to the
+     * configuration the caller has, or a "config" field containing the
+     * full configuration if the service no longer knows the requested
+     * generation (use 0 for the first call).
+     *
+     * @param [in] generation Last generation seen by the caller.
+     * @param [out] changes Resulting changes.
+     * @param [out] req Asynchronous request to wait on, if provided.
+     */
+    void getConfigSince(uint64_t generation, std::string* changes,
+                        AsyncRequest* req = nullptr) const;
+
     /**
      * @brief Send a Jx9 script to be executed by the server.
      * In the Jx9 script, $__config__ represents the server's configuration.
@@ -264,6 +264,10 @@ class Server:
     def spec(self) -> ProcSpec:
         return ProcSpec.from_dict(self.config)
 
+    @property
+    def startup_report(self) -> dict:
+        return json.loads(self._internal.startup_report)
+
     @property
     def margo(self) -> MargoManager:
         return MargoManager(self._internal.margo_manager, self)
@@ -1482,6 +1482,21 @@ class BedrockSpec:
 
     :param provider_id: Provider id at which to register Bedrock RPCs
     :type provider_id: int
+
+    :param provider_startup_pool: Pool in which to instantiate providers concurrently
+    :type provider_startup_pool: Optional[PoolSpec]
+
+    :param lazy_address_exchange: Whether MPI ranks fetch each other's addresses on demand
+    :type lazy_address_exchange: bool
+
+    :param startup_trace: File in which to write the startup report as trace events
+    :type startup_trace: Optional[str]
+
+    :param collective_timeout: Seconds to wait for each level of a tree of processes
+    :type collective_timeout: float
+
+    :param config_cache_ttl: Seconds after which the cached configuration is rebuilt (0 for never)
+    :type config_cache_ttl: float
     """
 
     pool: PoolSpec = attr.ib(
@@ -1489,12 +1504,38 @@ class BedrockSpec:
     provider_id: int = attr.ib(
         validator=instance_of(int),
         default=0)
+    provider_startup_pool: Optional[PoolSpec] = attr.ib(
+        validator=instance_of((PoolSpec, type(None))),
+        default=None)
+    lazy_address_exchange: bool = attr.ib(
+        validator=instance_of(bool),
+        default=False)
+    startup_trace: Optional[str] = attr.ib(
+        validator=instance_of((str, type(None))),
+        default=None)
+    collective_timeout: float = attr.ib(
+        validator=instance_of((float, int)),
+        default=30.0)
+    config_cache_ttl: float = attr.ib(
+        validator=instance_of((float, int)),
+        default=600.0)
 
     def to_dict(self) -> dict:
         """Convert the BedrockSpec into a dictionary.
         """
-        return {'pool': self.pool.name,
+        data = {'pool': self.pool.name,
                 'provider_id': self.provider_id}
+        if self.provider_startup_pool is not None:
+            data['provider_startup_pool'] = self.provider_startup_pool.name
+        if self.lazy_address_exchange:
+            data['lazy_address_exchange'] = True
+        if self.startup_trace is not None:
+            data['startup_trace'] = self.startup_trace
+        if self.collective_timeout != 30.0:
+            data['collective_timeout'] = self.collective_timeout
+        if self.config_cache_ttl != 600.0:
+            data['config_cache_ttl'] = self.config_cache_ttl
+        return data
 
     @staticmethod
     def from_dict(data: dict, abt_spec: ArgobotsSpec) -> 'BedrockSpec':
@@ -1510,6 +1551,8 @@ class BedrockSpec:
         """
         args = data.copy()
         args['pool'] = abt_spec.pools[data['pool']]
+        if 'provider_startup_pool' in data:
+            args['provider_startup_pool'] = abt_spec.pools[data['provider_startup_pool']]
         bedrock = BedrockSpec(**args)
         return bedrock
 
@@ -72,6 +72,10 @@ PYBIND11_MODULE(pybedrock_server, m) {
              [](std::shared_ptr<Server> server) {
                 return server->getCurrentConfig();
              })
+        .def_property_readonly("startup_report",
+             [](std::shared_ptr<Server> server) {
+                return server->getStartupReport();
+             })
         .def_property_readonly("margo_manager",
              [](std::shared_ptr<Server> server) {
                 return server->getMargoManager();
@@ -0,0 +1,132 @@
+/*
+ * (C) 2024 The University of Chicago
+ *
+ * See COPYRIGHT in top-level directory.
+ */
+#ifndef BEDROCK_ADDRESS_TABLE_H
+#define BEDROCK_ADDRESS_TABLE_H
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace bedrock {
+
+/**
+ * @brief Compact table of the addresses of a set of processes (e.g. the
+ * ranks of MPI_COMM_WORLD). Addresses of processes of a same job usually
+ * share a long prefix (protocol, network, part of the host name), so the
+ * table stores this prefix once, followed by the distinct suffixes
+ * concatenated in a single buffer.
+ */
+class AddressTable {
+
+    std::string           m_prefix;
+    std::vector<char>     m_suffixes; // distinct suffixes, concatenated
+    std::vector<uint32_t> m_offsets;  // offset of each distinct suffix, plus the end
+    std::vector<uint32_t> m_index;    // distinct suffix of each process, empty if all distinct
+
+  public:
+
+    AddressTable() = default;
+
+    /**
+     * @brief Builds the table from the prefix shared by all the addresses
+     * and the suffix of each address, concatenated.
+     *
+     * @param prefix Prefix shared by all the addresses.
+     * @param suffixes Concatenated suffixes.
+     * @param lengths Length of each suffix.
+     * @param count Number of addresses.
+     */
+    AddressTable(std::string prefix, const char* suffixes,
+                 const int* lengths, size_t count)
+    : m_prefix(std::move(prefix)) {
+        std::unordered_map<std::string_view, uint32_t> distinct;
+        std::vector<uint32_t> index;
+        index.reserve(count);
+        m_offsets.reserve(count + 1);
+        m_offsets.push_back(0);
+        bool duplicates = false;
+        for (size_t i = 0; i < count; ++i) {
+            auto suffix = std::string_view{suffixes, static_cast<size_t>(lengths[i])};
+            suffixes += lengths[i];
+            auto it = distinct.emplace(suffix, static_cast<uint32_t>(distinct.size())).first;
+            if (it->second + 1 < m_offsets.size()) {
+                duplicates = true;
+            } else {
+                m_suffixes.insert(m_suffixes.end(), suffix.begin(), suffix.end());
+                m_offsets.push_back(static_cast<uint32_t>(m_suffixes.size()));
+            }
+            index.push_back(it->second);
+        }
+        if (duplicates) m_index = std::move(index);
+        m_suffixes.shrink_to_fit();
+        m_offsets.shrink_to_fit();
+    }
+
+    /**
+     * @brief Builds the table from a list of addresses.
+     */
+    static AddressTable fromAddresses(const std::vector<std::string>& addresses) {
+        size_t prefix_length = addresses.empty() ? 0 : addresses[0].size();
+        for (auto& address : addresses)
+            prefix_length = commonPrefixLength(addresses[0], address, prefix_length);
+        std::string      suffixes;
+        std::vector<int> lengths;
+        lengths.reserve(addresses.size());
+        for (auto& address : addresses) {
+            suffixes.append(address, prefix_length, std::string::npos);
+            lengths.push_back(static_cast<int>(address.size() - prefix_length));
+        }
+        return AddressTable{addresses.empty() ? std::string{} : addresses[0].substr(0, prefix_length),
+                            suffixes.data(), lengths.data(), addresses.size()};
+    }
+
+    /**
+     * @brief Returns the length of the common prefix of a and b,
+     * up to max_length.
+     */
+    static size_t commonPrefixLength(std::string_view a, std::string_view b,
+                                     size_t max_length = std::string::npos) {
+        size_t n = std::min({a.size(), b.size(), max_length});
+        size_t i = 0;
+        while (i < n && a[i] == b[i]) ++i;
+        return i;
+    }
+
+    size_t size() const {
+        return m_index.empty() ? m_offsets.size() - (m_offsets.empty() ? 0 : 1) : m_index.size();
+    }
+
+    bool empty() const {
+        return size() == 0;
+    }
+
+    /**
+     * @brief Returns the address of the i-th process.
+     */
+    std::string operator[](size_t i) const {
+        auto id = m_index.empty() ? i : m_index[i];
+        std::string address;
+        address.reserve(m_prefix.size() + m_offsets[id + 1] - m_offsets[id]);
+        address += m_prefix;
+        address.append(m_suffixes.data() + m_offsets[id], m_offsets[id + 1] - m_offsets[id]);
+        return address;
+    }
+
+    /**
+     * @brief Returns the number of bytes used by the table's content.
+     */
+    size_t memoryUsage() const {
+        return m_prefix.size() + m_suffixes.size()
+             + (m_offsets.size() + m_index.size()) * sizeof(uint32_t);
+    }
+};
+
+} // namespace bedrock
+
+#endif
@@ -6,9 +6,120 @@
 #include "bedrock/Exception.hpp"
 #include "bedrock/AsyncRequest.hpp"
 #include "AsyncRequestImpl.hpp"
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
 
 namespace bedrock {
 
+namespace {
+
+/**
+ * @brief Invokes the continuations registered with AsyncRequest::then
+ * for a given pool. A single ULT polls the pending requests. When there
+ * are none left, the ULT exits and the runner is removed from the
+ * registry, so that it never prevents the pool's execution streams from
+ * being joined at finalization nor outlives the pool.
+ *
+ * Between polls, the ULT backs off (see PollingBackoff) so that it does
+ * not keep its execution stream busy while requests are slow to complete.
+ *
+ * The locks are taken from ULTs, hence Argobots mutexes. The registry's
+ * is statically initialized so that it does not depend on Argobots being
+ * initialized when it is created or still initialized when it is destroyed.
+ */
+class ContinuationRunner {
+
+    struct Continuation {
+        std::shared_ptr<AsyncRequestImpl>      request;
+        std::function<void(const Exception*)> callback;
+    };
+
+    static inline ABT_mutex_memory s_registry_mtx = ABT_MUTEX_INITIALIZER;
+    static inline std::unordered_map<ABT_pool, std::shared_ptr<ContinuationRunner>> s_registry;
+
+    struct RegistryLock {
+        ABT_mutex mtx = ABT_MUTEX_MEMORY_GET_HANDLE(&s_registry_mtx);
+        RegistryLock() { ABT_mutex_lock(mtx); }
+        ~RegistryLock() { ABT_mutex_unlock(mtx); }
+    };
+
+    tl::pool                  m_pool;
+    tl::mutex                 m_mtx;
+    std::vector<Continuation> m_queue;
+
+    void run() {
+        std::vector<Continuation> pending;
+        PollingBackoff            backoff;
+        while (true) {
+            {
+                std::lock_guard<tl::mutex> lock(m_mtx);
+                std::move(m_queue.begin(), m_queue.end(), std::back_inserter(pending));
+                m_queue.clear();
+            }
+            if (pending.empty()) {
+                RegistryLock               registry_lock;
+                std::lock_guard<tl::mutex> lock(m_mtx);
+                if (!m_queue.empty()) continue;
+                s_registry.erase(m_pool.native_handle());
+                return;
+            }
+            auto done = std::stable_partition(pending.begin(), pending.end(),
+                [](const Continuation& c) { return !c.request->completed(); });
+            for (auto it = done; it != pending.end(); ++it) invoke(*it);
+            bool waiting = done != pending.begin();
+            if (done != pending.end()) backoff.reset();
+            pending.erase(done, pending.end());
+            if (waiting) backoff.pause(pending.front().request->m_mid);
+        }
+    }
+
+    static void invoke(Continuation& c) {
+        std::optional<Exception> error;
+        try {
+            c.request->wait();
+        } catch (const Exception& ex) {
+            error = ex;
+        } catch (const std::exception& ex) {
+            error = Exception{"{}", ex.what()};
+        }
+        try {
+            c.callback(error ? &*error : nullptr);
+        } catch (const std::exception& ex) {
+            spdlog::error("Exception thrown by an AsyncRequest continuation: {}", ex.what());
+        }
+    }
+
+  public:
+
+    explicit ContinuationRunner(tl::pool pool)
+    : m_pool(std::move(pool)) {}
+
+    /**
+     * @brief Adds a continuation to the runner of the pool,
+     * starting a runner if the pool does not have one.
+     */
+    static void push(const tl::pool& pool,
+                     std::shared_ptr<AsyncRequestImpl> request,
+                     std::function<void(const Exception*)> callback) {
+        std::shared_ptr<ContinuationRunner> new_runner;
+        {
+            RegistryLock registry_lock;
+            auto& runner = s_registry[pool.native_handle()];
+            if (!runner) runner = new_runner = std::make_shared<ContinuationRunner>(pool);
+            std::lock_guard<tl::mutex> lock(runner->m_mtx);
+            runner->m_queue.push_back(Continuation{std::move(request), std::move(callback)});
+        }
+        if (new_runner)
+            new_runner->m_pool.make_thread([new_runner]() { new_runner->run(); },
+                                           tl::anonymous());
+    }
+};
+
+} // namespace
+
 AsyncRequest::AsyncRequest() = default;
 
 AsyncRequest::AsyncRequest(const std::shared_ptr<AsyncRequestImpl>& impl)
@@ -55,4 +166,65 @@ bool AsyncRequest::active() const {
     return self->active();
 }
 
+void AsyncRequest::then(std::function<void(const Exception*)> callback,
+                        const tl::pool& pool) {
+    if (not self) throw Exception("Invalid bedrock::AsyncRequest object");
+    if (not callback) throw Exception("Invalid callback passed to AsyncRequest::then");
+    ContinuationRunner::push(pool, std::move(self), std::move(callback));
+    self = nullptr;
+}
+
+std::future<void> AsyncRequest::toFuture(const tl::pool& pool) {
+    auto promise = std::make_shared<std::promise<void>>();
+    auto future  = promise->get_future();
+    then([promise](const Exception* error) {
+        if (error) promise->set_exception(std::make_exception_ptr(*error));
+        else promise->set_value();
+    }, pool);
+    return future;
+}
+
+size_t AsyncRequest::waitAny(const std::vector<AsyncRequest>& reqs) {
+    PollingBackoff backoff;
+    while (true) {
+        bool any_active = false;
+        margo_instance_id mid = MARGO_INSTANCE_NULL;
+        for (size_t i = 0; i < reqs.size(); ++i) {
+            if (!reqs[i].active()) continue;
+            any_active = true;
+            if (reqs[i].completed()) {
+                reqs[i].wait();
+                return i;
+            }
+            if (mid == MARGO_INSTANCE_NULL) mid = reqs[i].self->m_mid;
+        }
+        if (!any_active) return reqs.size();
+        backoff.pause(mid);
+    }
+}
+
+std::vector<size_t> AsyncRequest::waitSome(const std::vector<AsyncRequest>& reqs) {
+    std::vector<size_t> indices;
+    std::vector<std::shared_ptr<AsyncRequestImpl>> completed;
+    PollingBackoff backoff;
+    while (true) {
+        bool any_active = false;
+        margo_instance_id mid = MARGO_INSTANCE_NULL;
+        for (size_t i = 0; i < reqs.size(); ++i) {
+            if (!reqs[i].active()) continue;
+            any_active = true;
+            if (reqs[i].completed()) {
+                indices.push_back(i);
+                completed.push_back(reqs[i].self);
+            } else if (mid == MARGO_INSTANCE_NULL) {
+                mid = reqs[i].self->m_mid;
+            }
+        }
+        if (!any_active || !indices.empty()) break;
+        backoff.pause(mid);
+    }
+    MultiAsyncRequest{std::move(completed)}.wait();
+    return indices;
+}
+
 } // namespace bedrock
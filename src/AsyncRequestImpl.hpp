@@ -6,6 +6,7 @@
 #ifndef __BEDROCK_ASYNC_REQUEST_IMPL_H
 #define __BEDROCK_ASYNC_REQUEST_IMPL_H
 
+#include <algorithm>
 #include <functional>
 #include <thallium.hpp>
 #include "bedrock/Exception.hpp"
@@ -16,6 +17,10 @@ namespace tl = thallium;
 
 struct AsyncRequestImpl {
 
+    // Margo instance progressing the request, if any, used to sleep
+    // between polls of its completion (see PollingBackoff)
+    margo_instance_id m_mid = MARGO_INSTANCE_NULL;
+
     virtual ~AsyncRequestImpl() = default;
 
     virtual void wait() = 0;
@@ -36,8 +41,12 @@ struct AsyncThalliumResponse : public AsyncRequestImpl {
 
     void wait() override {
         if (m_waited) return;
-            m_waited = true;
-        m_wait_callback(*this);
+        m_waited = true;
+        // the callback (and what it captured, e.g. response buffers)
+        // is released once the response has been processed
+        auto callback = std::move(m_wait_callback);
+        m_wait_callback = nullptr;
+        if (callback) callback(*this);
     }
 
     bool completed() const override {
@@ -55,7 +64,14 @@ struct MultiAsyncRequest : public AsyncRequestImpl {
     std::function<void(MultiAsyncRequest&)> m_wait_callback;
 
     MultiAsyncRequest(std::vector<std::shared_ptr<AsyncRequestImpl>> reqs)
-    : m_reqs(std::move(reqs)) {}
+    : m_reqs(std::move(reqs)) {
+        for(auto& r : m_reqs) {
+            if(r && r->m_mid != MARGO_INSTANCE_NULL) {
+                m_mid = r->m_mid;
+                break;
+            }
+        }
+    }
 
     void wait() override {
         Exception first_exception{""};
@@ -80,7 +96,7 @@ struct MultiAsyncRequest : public AsyncRequestImpl {
 
     bool completed() const override {
         for(auto& r : m_reqs) {
-            if(!r->completed()) return false;
+            if(r->active() && !r->completed()) return false;
         }
         return true;
     }
@@ -90,6 +106,40 @@ struct MultiAsyncRequest : public AsyncRequestImpl {
     }
 };
 
+/**
+ * @brief Pauses a ULT that polls requests for their completion. It first
+ * only yields, then sleeps for an exponentially increasing duration (up
+ * to 1ms), so that a poller waiting for slow requests lets its execution
+ * stream idle instead of spinning on it. reset() is to be called when
+ * one of the requests completed.
+ */
+class PollingBackoff {
+
+    static constexpr unsigned yields       = 16;
+    static constexpr double   min_sleep_ms = 0.01;
+    static constexpr double   max_sleep_ms = 1.0;
+
+    unsigned m_polls    = 0;
+    double   m_sleep_ms = min_sleep_ms;
+
+  public:
+
+    void pause(margo_instance_id mid) {
+        if (m_polls < yields || mid == MARGO_INSTANCE_NULL) {
+            m_polls += 1;
+            tl::thread::yield();
+            return;
+        }
+        margo_thread_sleep(mid, m_sleep_ms);
+        m_sleep_ms = std::min(2 * m_sleep_ms, max_sleep_ms);
+    }
+
+    void reset() {
+        m_polls    = 0;
+        m_sleep_ms = min_sleep_ms;
+    }
+};
+
 } // namespace bedrock
 
 #endif
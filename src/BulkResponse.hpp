@@ -0,0 +1,51 @@
+/*
+ * (C) 2024 The University of Chicago
+ *
+ * See COPYRIGHT in top-level directory.
+ */
+#ifndef BEDROCK_BULK_RESPONSE_H
+#define BEDROCK_BULK_RESPONSE_H
+
+#include <thallium.hpp>
+#include <thallium/serialization/stl/string.hpp>
+#include <cstdint>
+#include <string>
+
+namespace bedrock {
+
+namespace tl = thallium;
+
+/**
+ * @brief Response to an RPC whose content may be too large for the
+ * RPC payload. Content up to the server's threshold is sent inline.
+ * Larger content is exposed by the server, and the client pulls it
+ * into a buffer of the right size then releases it with the
+ * "bedrock_release_response" RPC.
+ */
+struct BulkResponse {
+
+    // content up to this size is always sent inline
+    static constexpr size_t threshold = 16384;
+
+    std::string inlined;  // content, if sent inline
+    size_t      size     = 0;
+    bool        in_bulk  = false;
+    tl::bulk    bulk;     // content, if exposed by the server
+    uint64_t    id       = 0; // identifies the exposed content on the server
+    uint8_t     encoding = 0; // see Encoding, for RPCs returning JSON documents
+
+    template <typename Archive> void serialize(Archive& a) {
+        a& inlined;
+        a& size;
+        a& in_bulk;
+        if (in_bulk) {
+            a& bulk;
+            a& id;
+        }
+        a& encoding;
+    }
+};
+
+} // namespace bedrock
+
+#endif
@@ -49,7 +49,7 @@ const tl::engine& Client::engine() const { return self->m_engine; }
 
 ServiceHandle Client::makeServiceHandle(const std::string& address,
                                         uint16_t           provider_id) const {
-    auto endpoint = self->m_engine.lookup(address);
+    auto endpoint = self->m_endpoints->lookup(address);
     auto ph       = tl::provider_handle(endpoint, provider_id);
     auto service_impl
         = std::make_shared<ServiceHandleImpl>(self, std::move(ph));
@@ -6,6 +6,8 @@
 #ifndef __BEDROCK_CLIENT_IMPL_H
 #define __BEDROCK_CLIENT_IMPL_H
 
+#include "EndpointCache.hpp"
+#include "BulkResponse.hpp"
 #include <thallium.hpp>
 #include <thallium/serialization/stl/string.hpp>
 
@@ -16,11 +18,18 @@ namespace tl = thallium;
 class ClientImpl {
 
   public:
-    tl::engine           m_engine;
+    tl::engine                     m_engine;
+    std::shared_ptr<EndpointCache> m_endpoints;
     tl::remote_procedure m_get_config;
+    tl::remote_procedure m_get_config_encoded;
+    tl::remote_procedure m_get_config_since;
     tl::remote_procedure m_query_config;
+    tl::remote_procedure m_query_config_bulk;
+    tl::remote_procedure m_release_response;
+    tl::remote_procedure m_collective;
     tl::remote_procedure m_load_module;
     tl::remote_procedure m_start_provider;
+    tl::remote_procedure m_start_providers;
     tl::remote_procedure m_change_provider_pool;
     tl::remote_procedure m_migrate_provider;
     tl::remote_procedure m_snapshot_provider;
@@ -33,10 +42,17 @@ class ClientImpl {
     tl::remote_procedure m_remove_xstream;
 
     ClientImpl(const tl::engine& engine)
-    : m_engine(engine), m_get_config(m_engine.define("bedrock_get_config")),
+    : m_engine(engine), m_endpoints(EndpointCache::get(m_engine)),
+      m_get_config(m_engine.define("bedrock_get_config")),
+      m_get_config_encoded(m_engine.define("bedrock_get_config_encoded")),
+      m_get_config_since(m_engine.define("bedrock_get_config_since")),
       m_query_config(m_engine.define("bedrock_query_config")),
+      m_query_config_bulk(m_engine.define("bedrock_query_config_bulk")),
+      m_release_response(m_engine.define("bedrock_release_response").disable_response()),
+      m_collective(m_engine.define("bedrock_collective")),
       m_load_module(m_engine.define("bedrock_load_module")),
       m_start_provider(m_engine.define("bedrock_start_provider")),
+      m_start_providers(m_engine.define("bedrock_start_providers")),
       m_change_provider_pool(m_engine.define("bedrock_change_provider_pool")),
       m_migrate_provider(m_engine.define("bedrock_migrate_provider")),
       m_snapshot_provider(m_engine.define("bedrock_snapshot_provider")),
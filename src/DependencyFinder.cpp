@@ -4,14 +4,18 @@
  * See COPYRIGHT in top-level directory.
  */
 #include "DependencyFinderImpl.hpp"
+#include "DependencySpec.hpp"
 #include "bedrock/DependencyFinder.hpp"
 #include "bedrock/ModuleManager.hpp"
 #include "bedrock/AbstractComponent.hpp"
 #include "bedrock/Exception.hpp"
 #include "bedrock/ProviderHandle.hpp"
 #include <thallium.hpp>
+#include <thallium/serialization/stl/vector.hpp>
+#include <algorithm>
 #include <cctype>
-#include <regex>
+#include <chrono>
+#include <map>
 
 namespace tl = thallium;
 
@@ -67,61 +71,65 @@ std::shared_ptr<NamedDependency> DependencyFinder::find(
         if (resolved) { *resolved = spec; }
         return xstream;
 
-    } else if (spec.find("@") == std::string::npos) { // local provider
+    }
 
-        // the spec can be in the form "name" or "type:id"
-        std::regex re(
-            "([a-zA-Z_][a-zA-Z0-9_]*)" // identifier (name or type)
-            "(?::([0-9]+))?");         // specifier ("client" or provider id)
-        std::smatch match;
-        if (!std::regex_search(spec, match, re) || match.str(0) != spec) {
-            throw Exception("Ill-formated dependency specification \"{}\"", spec);
-        }
-        auto identifier      = match.str(1); // name or type
-        auto provider_id_str = match.str(2); // provider id
+    // the spec can be in the form "name" or "type:id",
+    // optionally followed by "@locator"
+    DependencySpec parsed;
+    if (!parseDependencySpec(spec, parsed)) {
+        throw Exception("Ill-formated dependency specification \"{}\"", spec);
+    }
+    auto identifier = std::string{parsed.identifier}; // name or type
 
-        if(provider_id_str.empty()) { // identifier is a name
+    if (!parsed.has_locator) { // local provider
+
+        if(parsed.provider_id_str.empty()) { // identifier is a name
             uint16_t provider_id;
             auto ptr = findProvider(type, identifier, &provider_id);
             if (resolved) *resolved = type + ":" + std::to_string(provider_id);
             return ptr;
         } else {
-            uint16_t provider_id = std::atoi(provider_id_str.c_str());
-            auto ptr = findProvider(type, provider_id);
-            if (resolved) *resolved = type + ":" + std::to_string(provider_id);
+            auto ptr = findProvider(type, parsed.provider_id);
+            if (resolved) *resolved = type + ":" + std::to_string(parsed.provider_id);
             return ptr;
         }
 
     } else { // Provider handle
 
-        std::regex re(
-            "([a-zA-Z_][a-zA-Z0-9_]*)"          // identifier (name or type)
-            "(?::([0-9]+))?"                    // optional provider id
-            "(?:@(.+))?");                      // optional locator (@address)
-        std::smatch match;
-        if (!std::regex_search(spec, match, re) || match.str(0) != spec) {
-            throw Exception("Ill-formated dependency specification \"{}\"", spec);
+        // address or "local" or MPI rank
+        auto locator = std::string{parsed.locator};
+
+        // handles to remote providers require a remote lookup, so they
+        // are kept in a cache of resolved specs while a scope is open
+        auto cache_key = type + "/" + spec;
+        bool cacheable = locator != "local" && self->cachingResolutions();
+        if (cacheable) {
+            auto cached = self->m_resolved_cache.get(cache_key);
+            if (cached) {
+                if (resolved) *resolved = cached->resolved;
+                return cached->handle;
+            }
         }
 
-        auto identifier      = match.str(1); // name or type
-        auto provider_id_str = match.str(2); // provider id
-        auto locator         = match.str(3); // address or "local" or MPI rank
-        if(locator.empty()) locator = "local";
-
-        if (provider_id_str.empty()) {
+        std::shared_ptr<NamedDependency> handle;
+        std::string                      handle_resolved;
+        if (parsed.provider_id_str.empty()) {
             // dependency specified as name@location
-            return makeProviderHandle(type, identifier, locator, resolved);
+            handle = makeProviderHandle(type, identifier, locator, &handle_resolved);
 
         } else {
             // dependency specified as type:id@location
-            uint16_t provider_id = atoi(provider_id_str.c_str());
             if (type != identifier) {
                 throw Exception(
                         "Invalid provider type in \"{}\" (expected {})",
                         spec, type);
             }
-            return makeProviderHandle(type, provider_id, locator, resolved);
+            handle = makeProviderHandle(type, parsed.provider_id, locator, &handle_resolved);
         }
+        if (cacheable)
+            self->m_resolved_cache.put(cache_key, {handle, handle_resolved});
+        if (resolved) *resolved = std::move(handle_resolved);
+        return handle;
     }
     return nullptr;
 }
@@ -156,6 +164,89 @@ std::shared_ptr<NamedDependency> DependencyFinder::find(
     return nullptr;
 }
 
+void DependencyFinder::prefetch(const std::vector<std::string>& specs) const {
+    // prefetched descriptors would be dropped right away outside of a scope
+    if (!self->cachingResolutions()) return;
+    auto provider_manager_impl = self->m_provider_manager.lock();
+    if (!provider_manager_impl) return;
+    auto pid = provider_manager_impl->get_provider_id();
+    auto own_address = static_cast<std::string>(self->m_engine.self());
+
+    // group the remote specs by destination, in the same form
+    // as the ones sent by makeProviderHandle
+    std::map<std::string, std::vector<std::string>> specs_by_address;
+    for (const auto& spec : specs) {
+        DependencySpec parsed;
+        if (!parseDependencySpec(spec, parsed) || !parsed.has_locator) continue;
+        auto locator = std::string{parsed.locator};
+        int  rank    = 0;
+        if (parseRankLocator(locator, rank)) {
+            try {
+                auto mpi = MPIEnv(self->m_mpi);
+                if (rank == mpi.globalRank()) continue;
+                locator = mpi.addressOfRank(rank);
+            } catch (const std::exception&) { continue; }
+        }
+        // providers of this process are looked up locally when created
+        if (locator == "local" || locator == own_address) continue;
+        auto remote_spec = std::string{parsed.identifier};
+        if (!parsed.provider_id_str.empty())
+            remote_spec += ":" + std::to_string(parsed.provider_id);
+        specs_by_address[locator].push_back(std::move(remote_spec));
+    }
+    if (specs_by_address.empty()) return;
+
+    struct PendingLookup {
+        tl::endpoint             endpoint;
+        std::vector<std::string> specs;
+        tl::async_response       response;
+    };
+    std::vector<PendingLookup> pending;
+    pending.reserve(specs_by_address.size());
+    for (auto& [address, address_specs] : specs_by_address) {
+        try {
+            auto endpoint = self->m_endpoints->lookup(address);
+            auto prefix   = static_cast<std::string>(endpoint) + "/";
+            if (prefix == own_address + "/") continue;
+            // skip the specs that were already resolved
+            address_specs.erase(
+                std::remove_if(address_specs.begin(), address_specs.end(),
+                    [this, &prefix](const auto& s) {
+                        return self->m_remote_descriptors.get(prefix + s).has_value();
+                    }),
+                address_specs.end());
+            if (address_specs.empty()) continue;
+            auto ph       = tl::provider_handle(endpoint, pid);
+            // Prefetching is best-effort: the destination does not wait for
+            // providers that do not exist yet (timeout of 0) and a destination
+            // that does not answer quickly (e.g. still starting) is skipped.
+            // The specs that are not resolved here are looked up individually,
+            // with the full timeout, when the providers are created.
+            auto response = self->m_lookup_providers.on(ph).timed_async(
+                std::chrono::duration<double>(self->m_prefetch_timeout), address_specs, 0.0);
+            pending.push_back({endpoint, std::move(address_specs), std::move(response)});
+        } catch (const std::exception& ex) {
+            spdlog::debug("Could not prefetch providers from {}: {}", address, ex.what());
+        }
+    }
+    spdlog::trace("Prefetching remote providers from {} destinations", pending.size());
+
+    for (auto& p : pending) {
+        try {
+            std::vector<RequestResult<ProviderDescriptor>> results = p.response.wait();
+            auto address = static_cast<std::string>(p.endpoint);
+            for (size_t i = 0; i < results.size() && i < p.specs.size(); ++i) {
+                if (!results[i].success()) continue;
+                self->m_remote_descriptors.put(address + "/" + p.specs[i], results[i].value());
+            }
+        } catch (const tl::exception& ex) {
+            self->m_endpoints->invalidate(p.endpoint);
+            spdlog::debug("Could not prefetch providers from {}: {}",
+                          static_cast<std::string>(p.endpoint), ex.what());
+        }
+    }
+}
+
 std::shared_ptr<NamedDependency>
 DependencyFinder::findProvider(const std::string& type,
                                uint16_t           provider_id) const {
@@ -203,17 +294,8 @@ DependencyFinder::makeProviderHandle(const std::string& type,
     auto engine = MargoManager(self->m_margo_context).getThalliumEngine();
     thallium::endpoint endpoint;
 
-    bool locator_is_number = true;
     int rank = 0;
-    for(auto c : locator) {
-        if(c >= '0' && c <= '9') {
-            rank = rank*10 + (c - '0');
-            continue;
-        }
-        locator_is_number = false;
-        break;
-    }
-    if(locator_is_number) locator = MPIEnv(self->m_mpi).addressOfRank(rank);
+    if(parseRankLocator(locator, rank)) locator = MPIEnv(self->m_mpi).addressOfRank(rank);
 
     if (locator == "local") {
 
@@ -245,7 +327,7 @@ DependencyFinder::makeProviderHandle(const std::string& type,
     } else {
 
         try {
-            endpoint = engine.lookup(locator);
+            endpoint = self->m_endpoints->lookup(locator);
         } catch(const std::exception& ex) {
             throw Exception(
                     "Failed to lookup address {} "
@@ -285,17 +367,8 @@ DependencyFinder::makeProviderHandle(const std::string& type,
     spdlog::trace("Making provider handle to provider {} of type {} at {}",
                   name, type, locator);
 
-    bool locator_is_number = true;
     int rank = 0;
-    for(auto c : locator) {
-        if(c >= '0' && c <= '9') {
-            rank = rank*10 + (c - '0');
-            continue;
-        }
-        locator_is_number = false;
-        break;
-    }
-    if(locator_is_number) locator = MPIEnv(self->m_mpi).addressOfRank(rank);
+    if(parseRankLocator(locator, rank)) locator = MPIEnv(self->m_mpi).addressOfRank(rank);
 
     if (locator == "local") {
 
@@ -329,7 +402,7 @@ DependencyFinder::makeProviderHandle(const std::string& type,
     } else {
 
         try {
-            endpoint = engine.lookup(locator);
+            endpoint = self->m_endpoints->lookup(locator);
         } catch(const std::exception& ex) {
             throw Exception(
                     "Failed to lookup address {} "
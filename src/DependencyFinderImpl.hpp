@@ -10,10 +10,15 @@
 #include "ProviderManagerImpl.hpp"
 #include "Formatting.hpp"
 #include "MPIEnvImpl.hpp"
+#include "LRUCache.hpp"
+#include "EndpointCache.hpp"
 #include "bedrock/VoidPtr.hpp"
 #include "bedrock/RequestResult.hpp"
 #include <bedrock/Exception.hpp>
 #include <thallium.hpp>
+#include <thallium/serialization/stl/vector.hpp>
+#include <atomic>
+#include <optional>
 #include <string>
 #include <unordered_map>
 
@@ -21,6 +26,37 @@ namespace tl = thallium;
 
 namespace bedrock {
 
+/**
+ * @brief Result of resolving a dependency specification to a provider handle.
+ */
+struct ResolvedProviderHandle {
+    std::shared_ptr<NamedDependency> handle;
+    std::string                      resolved;
+};
+
+class DependencyFinderImpl;
+
+/**
+ * @brief While at least one ResolutionScope is open, the DependencyFinder
+ * caches the remote providers it resolves, so that a dependency shared by
+ * the providers of a list is only resolved once. The cache is cleared
+ * when the last scope closes. A scope on a null DependencyFinderImpl
+ * does nothing.
+ */
+class ResolutionScope {
+
+    std::shared_ptr<DependencyFinderImpl> m_finder;
+
+  public:
+
+    explicit ResolutionScope(std::shared_ptr<DependencyFinderImpl> finder);
+
+    ResolutionScope(const ResolutionScope&) = delete;
+    ResolutionScope& operator=(const ResolutionScope&) = delete;
+
+    ~ResolutionScope();
+};
+
 class DependencyFinderImpl {
 
     using client_type = std::string;
@@ -30,13 +66,28 @@ class DependencyFinderImpl {
     std::shared_ptr<MPIEnvImpl>        m_mpi;
     std::shared_ptr<MargoManagerImpl>  m_margo_context;
     std::weak_ptr<ProviderManagerImpl> m_provider_manager;
+    std::shared_ptr<EndpointCache>     m_endpoints;
     double                             m_timeout = 30.0;
 
+    // Provider handles resolved from "<type>/<spec>" keys. Remote providers
+    // may be removed, migrated or restarted at any time, so resolutions are
+    // only cached while a ResolutionScope is open (e.g. while a list of
+    // providers is being created) and dropped when the last one closes.
+    LRUCache<std::string, ResolvedProviderHandle> m_resolved_cache{1024};
+    std::atomic<int>                              m_open_scopes{0};
+    // remote lookups results from "<address>/<spec>" keys, also only
+    // kept while a ResolutionScope is open
+    LRUCache<std::string, ProviderDescriptor>     m_remote_descriptors{1024};
+    double                                        m_prefetch_timeout = 1.0; // seconds
+
     tl::remote_procedure m_lookup_provider;
+    tl::remote_procedure m_lookup_providers;
 
     DependencyFinderImpl(const tl::engine& engine)
     : m_engine(engine),
-      m_lookup_provider(m_engine.define("bedrock_lookup_provider")) {
+      m_endpoints(EndpointCache::get(m_engine)),
+      m_lookup_provider(m_engine.define("bedrock_lookup_provider")),
+      m_lookup_providers(m_engine.define("bedrock_lookup_providers")) {
         spdlog::trace("DependencyFinderImpl initialized");
     }
 
@@ -44,17 +95,49 @@ class DependencyFinderImpl {
         spdlog::trace("DependencyFinderImpl destroyed");
     }
 
+    bool cachingResolutions() const {
+        return m_open_scopes > 0;
+    }
+
+    void clearResolutions() {
+        m_resolved_cache.clear();
+        m_remote_descriptors.clear();
+    }
+
     void lookupRemoteProvider(const tl::endpoint& addr, uint16_t provider_id,
                               const std::string&  spec,
                               ProviderDescriptor* desc) {
+        auto key     = static_cast<std::string>(addr) + "/" + spec;
+        bool caching = cachingResolutions();
+        auto cached  = caching ? m_remote_descriptors.get(key) : std::nullopt;
+        if (cached) {
+            if (desc) *desc = *cached;
+            return;
+        }
         auto ph = tl::provider_handle(addr, provider_id);
-        RequestResult<ProviderDescriptor> result
-            = m_lookup_provider.on(ph)(spec, m_timeout);
+        RequestResult<ProviderDescriptor> result;
+        try {
+            result = m_lookup_provider.on(ph)(spec, m_timeout);
+        } catch(const tl::exception&) {
+            m_endpoints->invalidate(addr);
+            throw;
+        }
         if (result.error() != "") throw Exception(result.error());
+        if (caching) m_remote_descriptors.put(key, result.value());
         if (desc) *desc = result.value();
     }
 };
 
+inline ResolutionScope::ResolutionScope(std::shared_ptr<DependencyFinderImpl> finder)
+: m_finder(std::move(finder)) {
+    if (m_finder) m_finder->m_open_scopes += 1;
+}
+
+inline ResolutionScope::~ResolutionScope() {
+    if (m_finder && --m_finder->m_open_scopes == 0)
+        m_finder->clearResolutions();
+}
+
 } // namespace bedrock
 
 #endif
@@ -0,0 +1,90 @@
+/*
+ * (C) 2024 The University of Chicago
+ *
+ * See COPYRIGHT in top-level directory.
+ */
+#ifndef BEDROCK_DEPENDENCY_SPEC_H
+#define BEDROCK_DEPENDENCY_SPEC_H
+
+#include <cstdint>
+#include <string_view>
+
+namespace bedrock {
+
+/**
+ * @brief Parsed dependency specification, in the form
+ * "<identifier>[:<provider-id>][@<locator>]", where the identifier
+ * is a provider name or a provider type. The fields are views into
+ * the parsed string, which must outlive the DependencySpec.
+ */
+struct DependencySpec {
+    std::string_view identifier;      // name or type
+    std::string_view provider_id_str; // empty if no provider id
+    std::string_view locator;         // empty if no locator
+    uint16_t         provider_id = 0; // valid if provider_id_str isn't empty
+    bool             has_locator = false;
+};
+
+/**
+ * @brief Parses a dependency specification without allocating memory.
+ * The identifier must match [a-zA-Z_][a-zA-Z0-9_]*, the provider id
+ * must be made of at least one digit, and the locator (anything after
+ * the first '@') must not be empty.
+ *
+ * @param spec Specification string.
+ * @param result Parsed specification.
+ *
+ * @return false if the specification is ill-formed.
+ */
+inline bool parseDependencySpec(std::string_view spec, DependencySpec& result) {
+    auto is_alpha = [](char c) {
+        return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+    };
+    auto is_digit = [](char c) { return c >= '0' && c <= '9'; };
+
+    result = DependencySpec{};
+    size_t i = 0, n = spec.size();
+
+    if (i == n || !is_alpha(spec[i])) return false;
+    while (i < n && (is_alpha(spec[i]) || is_digit(spec[i]))) ++i;
+    result.identifier = spec.substr(0, i);
+
+    if (i < n && spec[i] == ':') {
+        size_t start = ++i;
+        unsigned provider_id = 0;
+        while (i < n && is_digit(spec[i])) {
+            provider_id = provider_id * 10 + (spec[i] - '0');
+            ++i;
+        }
+        if (i == start) return false;
+        result.provider_id_str = spec.substr(start, i - start);
+        result.provider_id     = static_cast<uint16_t>(provider_id);
+    }
+
+    if (i < n && spec[i] == '@') {
+        if (i + 1 == n) return false;
+        result.has_locator = true;
+        result.locator     = spec.substr(i + 1);
+        i = n;
+    }
+
+    return i == n;
+}
+
+/**
+ * @brief Checks whether a locator is an MPI rank (a possibly empty
+ * sequence of digits) and, if so, sets rank accordingly.
+ */
+inline bool parseRankLocator(std::string_view locator, int& rank) {
+    int r = 0;
+    for (auto c : locator) {
+        if (c < '0' || c > '9') return false;
+        r = r * 10 + (c - '0');
+    }
+    rank = r;
+    return true;
+}
+
+} // namespace bedrock
+
+#endif
@@ -0,0 +1,69 @@
+/*
+ * (C) 2024 The University of Chicago
+ *
+ * See COPYRIGHT in top-level directory.
+ */
+#ifndef BEDROCK_ENCODING_H
+#define BEDROCK_ENCODING_H
+
+#include <nlohmann/json.hpp>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace bedrock {
+
+/**
+ * @brief Encodings of JSON documents exchanged by Bedrock RPCs.
+ * A client proposes an encoding and the server answers with the
+ * encoding it actually used, JSON if it does not know the proposed one.
+ */
+enum class Encoding : uint8_t {
+    JSON        = 0,
+    CBOR        = 1,
+    MessagePack = 2
+};
+
+/**
+ * @brief Returns the encoding corresponding to the value, or JSON
+ * if the value does not correspond to a known encoding.
+ */
+inline Encoding encodingFromValue(uint8_t value) {
+    switch (static_cast<Encoding>(value)) {
+    case Encoding::CBOR:
+    case Encoding::MessagePack:
+        return static_cast<Encoding>(value);
+    default:
+        return Encoding::JSON;
+    }
+}
+
+inline std::string encodeJSON(const nlohmann::json& document, Encoding encoding) {
+    std::string result;
+    switch (encoding) {
+    case Encoding::CBOR:
+        nlohmann::json::to_cbor(document, result);
+        break;
+    case Encoding::MessagePack:
+        nlohmann::json::to_msgpack(document, result);
+        break;
+    default:
+        result = document.dump();
+    }
+    return result;
+}
+
+inline nlohmann::json decodeJSON(std::string_view content, Encoding encoding) {
+    switch (encoding) {
+    case Encoding::CBOR:
+        return nlohmann::json::from_cbor(content.begin(), content.end());
+    case Encoding::MessagePack:
+        return nlohmann::json::from_msgpack(content.begin(), content.end());
+    default:
+        return nlohmann::json::parse(content.begin(), content.end());
+    }
+}
+
+} // namespace bedrock
+
+#endif
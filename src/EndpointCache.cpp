@@ -0,0 +1,36 @@
+/*
+ * (C) 2024 The University of Chicago
+ *
+ * See COPYRIGHT in top-level directory.
+ */
+#include "EndpointCache.hpp"
+#include <mutex>
+
+namespace bedrock {
+
+static std::mutex s_registry_mtx;
+static std::unordered_map<margo_instance_id, std::shared_ptr<EndpointCache>> s_registry;
+
+std::shared_ptr<EndpointCache> EndpointCache::get(const tl::engine& engine) {
+    auto mid = engine.get_margo_instance();
+    std::lock_guard<std::mutex> lock(s_registry_mtx);
+    auto& cache = s_registry[mid];
+    if (!cache) {
+        cache = std::make_shared<EndpointCache>(mid);
+        // endpoints must be freed before Mercury is finalized
+        tl::engine(engine).push_finalize_callback([mid]() {
+            std::shared_ptr<EndpointCache> cache;
+            {
+                std::lock_guard<std::mutex> lock(s_registry_mtx);
+                auto it = s_registry.find(mid);
+                if (it == s_registry.end()) return;
+                cache = std::move(it->second);
+                s_registry.erase(it);
+            }
+            cache->clear();
+        });
+    }
+    return cache;
+}
+
+} // namespace bedrock
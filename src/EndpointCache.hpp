@@ -0,0 +1,121 @@
+/*
+ * (C) 2024 The University of Chicago
+ *
+ * See COPYRIGHT in top-level directory.
+ */
+#ifndef BEDROCK_ENDPOINT_CACHE_H
+#define BEDROCK_ENDPOINT_CACHE_H
+
+#include <thallium.hpp>
+#include <spdlog/spdlog.h>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+namespace bedrock {
+
+namespace tl = thallium;
+
+/**
+ * @brief Cache of endpoints looked up by address, shared by the
+ * DependencyFinder, the Clients and the ServiceGroupHandles using
+ * the same margo instance. tl::endpoint is reference-counted, so
+ * all the handles built from a cached endpoint share the same
+ * underlying hg_addr_t.
+ *
+ * Entries can be invalidated explicitly (e.g. when an RPC to the
+ * address fails) and optionally expire after a time-to-live.
+ * The cache for a margo instance is emptied and dropped when
+ * that instance finalizes.
+ */
+class EndpointCache {
+
+    struct Entry {
+        tl::endpoint endpoint;
+        double       timestamp;
+    };
+
+    margo_instance_id                      m_mid; // not a tl::engine, to not hold a reference
+    std::unordered_map<std::string, Entry> m_entries;
+    double                                 m_ttl = 0.0; // seconds, 0 means no expiry
+    mutable tl::mutex                      m_mtx;
+
+    public:
+
+    explicit EndpointCache(margo_instance_id mid)
+    : m_mid(mid) {}
+
+    /**
+     * @brief Returns the EndpointCache associated with the engine's
+     * margo instance, creating it if needed.
+     */
+    static std::shared_ptr<EndpointCache> get(const tl::engine& engine);
+
+    /**
+     * @brief Sets the time-to-live of entries, in seconds (0 for no expiry).
+     */
+    void setTTL(double ttl) {
+        std::lock_guard<tl::mutex> lock(m_mtx);
+        m_ttl = ttl;
+    }
+
+    /**
+     * @brief Returns the endpoint for the address, looking it up
+     * only if it is not in the cache or has expired.
+     */
+    tl::endpoint lookup(const std::string& address) {
+        auto now = tl::timer::wtime();
+        {
+            std::lock_guard<tl::mutex> lock(m_mtx);
+            auto it = m_entries.find(address);
+            if (it != m_entries.end()) {
+                if (m_ttl <= 0.0 || now - it->second.timestamp < m_ttl)
+                    return it->second.endpoint;
+                m_entries.erase(it);
+            }
+        }
+        // the lookup itself is done without holding the lock
+        auto endpoint = tl::engine{m_mid}.lookup(address);
+        std::lock_guard<tl::mutex> lock(m_mtx);
+        auto it = m_entries.emplace(address, Entry{endpoint, now}).first;
+        return it->second.endpoint;
+    }
+
+    /**
+     * @brief Removes the address from the cache.
+     */
+    void invalidate(const std::string& address) {
+        std::lock_guard<tl::mutex> lock(m_mtx);
+        if (m_entries.erase(address))
+            spdlog::debug("Invalidated cached endpoint for {}", address);
+    }
+
+    /**
+     * @brief Removes all the entries pointing to this endpoint.
+     */
+    void invalidate(const tl::endpoint& endpoint) {
+        std::lock_guard<tl::mutex> lock(m_mtx);
+        for (auto it = m_entries.begin(); it != m_entries.end();) {
+            if (it->second.endpoint == endpoint) {
+                spdlog::debug("Invalidated cached endpoint for {}", it->first);
+                it = m_entries.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    void clear() {
+        std::lock_guard<tl::mutex> lock(m_mtx);
+        m_entries.clear();
+    }
+
+    size_t size() const {
+        std::lock_guard<tl::mutex> lock(m_mtx);
+        return m_entries.size();
+    }
+};
+
+} // namespace bedrock
+
+#endif
@@ -10,7 +10,9 @@
 #include <bedrock/Jx9Manager.hpp>
 #include <nlohmann/json.hpp>
 #include <nlohmann/json-schema.hpp>
+#include <algorithm>
 #include <string>
+#include <vector>
 
 namespace bedrock {
 
@@ -85,37 +87,69 @@ static inline json expandSimplifiedJSON(const json& input) {
     return output;
 }
 
-static inline json filterIfConditionsInJSON(const json& input, Jx9Manager jx9) {
-    json output; // null by default
-    if(input.is_array()) {
-        output = json::array();
-        for(auto& item : input) {
-            auto filteredItem = filterIfConditionsInJSON(item, jx9);
-            if(filteredItem.is_null()) continue;
-            output.push_back(filterIfConditionsInJSON(item, jx9));
-        }
-    } else if(input.is_object()) {
-        bool condition = true;
-        if(input.contains("__if__")) {
-            auto _if = input["__if__"];
-            if(_if.is_boolean()) condition = _if.get<bool>();
-            else if(_if.is_string())
-                condition = jx9.evaluateCondition(
-                    _if.get_ref<const std::string&>(),
-                    std::unordered_map<std::string, std::string>());
-            else
+static inline void removeNullsFromArrays(json& node) {
+    if(node.is_array()) {
+        auto& array = node.get_ref<json::array_t&>();
+        array.erase(std::remove_if(array.begin(), array.end(),
+                    [](const json& item) { return item.is_null(); }),
+                    array.end());
+        for(auto& item : array) removeNullsFromArrays(item);
+    } else if(node.is_object()) {
+        for(auto& p : node.items()) removeNullsFromArrays(p.value());
+    }
+}
+
+/**
+ * @brief Filters, in place, the objects of the document that have an
+ * "__if__" field evaluating to false (the object is replaced with null,
+ * and removed if it is an element of an array). The "__if__" field is
+ * either a boolean or a Jx9 condition. The conditions of a same nesting
+ * level are evaluated in a single execution of the Jx9 VM, and the
+ * conditions nested in an object whose condition is false are never
+ * evaluated.
+ */
+static inline void filterIfConditionsInJSON(json& document, const Jx9Manager& jx9) {
+    std::vector<json*> pending = {&document};
+    std::vector<json*> conditional;
+    std::vector<std::string> conditions;
+    while(!pending.empty()) {
+        std::vector<json*> next;
+        auto visit_children = [&next](json* node) {
+            for(auto& p : node->items()) next.push_back(&p.value());
+        };
+        // resolve boolean conditions, collect Jx9 conditions
+        for(auto node : pending) {
+            if(node->is_array()) {
+                visit_children(node);
+                continue;
+            }
+            if(!node->is_object()) continue;
+            auto it = node->find("__if__");
+            if(it == node->end()) {
+                visit_children(node);
+            } else if(it->is_boolean()) {
+                if(it->get<bool>()) visit_children(node);
+                else *node = nullptr;
+            } else if(it->is_string()) {
+                conditional.push_back(node);
+                conditions.push_back(it->get<std::string>());
+            } else {
                 throw Exception("__if__ condition should be a string or a boolean");
+            }
         }
-        if(condition) {
-            output = json::object();
-            for(auto& p : input.items()) {
-                output[p.key()] = filterIfConditionsInJSON(p.value(), jx9);
+        // evaluate all the Jx9 conditions of this level at once
+        if(!conditions.empty()) {
+            auto results = jx9.evaluateConditions(conditions, {});
+            for(size_t i = 0; i < results.size(); ++i) {
+                if(results[i]) visit_children(conditional[i]);
+                else *conditional[i] = nullptr;
             }
+            conditional.clear();
+            conditions.clear();
         }
-    } else {
-        output = input;
+        pending = std::move(next);
     }
-    return output;
+    removeNullsFromArrays(document);
 }
 
 }
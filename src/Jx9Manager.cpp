@@ -8,6 +8,9 @@
 #include "Jx9ManagerImpl.hpp"
 #include <nlohmann/json.hpp>
 #include <map>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_set>
 #ifdef ENABLE_MPI
 #include <mpi.h>
 #endif
@@ -37,12 +40,12 @@ Jx9Manager::operator bool() const { return static_cast<bool>(self); }
 
 void Jx9Manager::setVariable(const std::string& name,
                              const std::string& value) {
-    std::lock_guard<tl::mutex> lock(self->m_mtx);
+    std::unique_lock<RWLock> lock(self->m_globals_mtx);
     self->m_global_variables[name] = value;
 }
 
 void Jx9Manager::unsetVariable(const std::string& name) {
-    std::lock_guard<tl::mutex> lock(self->m_mtx);
+    std::unique_lock<RWLock> lock(self->m_globals_mtx);
     self->m_global_variables.erase(name);
 }
 
@@ -52,104 +55,143 @@ std::string Jx9Manager::executeQuery(
     const std::string&                                  script,
     const std::unordered_map<std::string, std::string>& variables) const {
     if (!self) throw BEDROCK_DETAILED_EXCEPTION("Calling executeQuery on invalid Jx9Manager");
-    std::lock_guard<tl::mutex> lock(self->m_mtx);
-    int                        ret;
+    std::unordered_map<std::string, json> parsed_variables;
+    for (auto& p : variables) {
+        try {
+            parsed_variables.emplace(p.first, json::parse(p.second));
+        } catch (...) {
+            throw BEDROCK_DETAILED_EXCEPTION("Could not create Jx9 value from variable \"{}\"",
+                            p.first);
+        }
+    }
+    return executeQuery(script, parsed_variables);
+}
+
+std::string Jx9Manager::executeQuery(
+    const std::string&                           script,
+    const std::unordered_map<std::string, json>& variables) const {
+    std::unordered_map<std::string, const json*> variable_ptrs;
+    for (auto& p : variables) variable_ptrs.emplace(p.first, &p.second);
+    return executeQuery(script, variable_ptrs);
+}
+
+std::string Jx9Manager::executeQuery(
+    const std::string&                                  script,
+    const std::unordered_map<std::string, const json*>& variables) const {
+    if (!self) throw BEDROCK_DETAILED_EXCEPTION("Calling executeQuery on invalid Jx9Manager");
+    int ret;
 
     spdlog::trace("Jx9Manager about to execute the following program:\n{}", script);
 
-    // compile script into a VM
-    jx9_vm* vm;
-    ret = jx9_compile(self->m_engine, script.c_str(), script.size(), &vm);
-    if (ret != JX9_OK) {
-        char* errLog;
-        int   errLogLength;
-        jx9_config(self->m_engine, JX9_CONFIG_ERR_LOG, &errLog, &errLogLength);
-        auto err = std::string(errLog, errLogLength);
-        if(err[errLogLength-1] == '\n') err.resize(errLogLength-1);
-        throw BEDROCK_DETAILED_EXCEPTION("Jx9 script failed to compile: {}", err);
-    }
+    // concurrent executions each use their own engine
+    auto engine = self->acquireEngine();
 
-    // installing MPI_COMM_WORLD
-    json comm_world = nullptr;
-#ifdef ENABLE_MPI
-    if(self->m_mpi.isEnabled()) {
-        comm_world = json::object();
-        comm_world["rank"] = self->m_mpi.globalRank();
-        comm_world["size"] = self->m_mpi.globalSize();
-        comm_world["addresses"] = json::array();
-        for(int i = 0; i < self->m_mpi.globalSize(); ++i) {
-            comm_world["addresses"].push_back(
-                self->m_mpi.addressOfRank(i));
+    // get the compiled program from the cache, or compile script into a VM
+    auto program = engine->acquireProgram(script);
+    if (program) {
+        jx9_vm_reset(program->vm);
+    } else {
+        jx9_vm* vm;
+        ret = jx9_compile(engine->m_engine, script.c_str(), script.size(), &vm);
+        if (ret != JX9_OK) {
+            char* errLog;
+            int   errLogLength;
+            jx9_config(engine->m_engine, JX9_CONFIG_ERR_LOG, &errLog, &errLogLength);
+            auto err = std::string(errLog, errLogLength);
+            if(err[errLogLength-1] == '\n') err.resize(errLogLength-1);
+            throw BEDROCK_DETAILED_EXCEPTION("Jx9 script failed to compile: {}", err);
         }
+        program = std::make_unique<Jx9Program>(script, vm);
+
+        // redirect VM output to stdout
+        jx9_vm_config(vm, JX9_VM_CONFIG_OUTPUT,
+                      static_cast<int (*)(const void*, unsigned, void*)>(
+                          [](const void* pOutput, unsigned int nLen, void*) -> int {
+                              auto s = std::string((const char*)pOutput, nLen);
+                              spdlog::info("[jx9] {}", s);
+                              return JX9_OK;
+                          }),
+                      NULL);
+
+        // make errors appear in output
+        jx9_vm_config(vm, JX9_VM_CONFIG_ERR_REPORT);
     }
-#endif
-    jx9_value* jx9_comm_world = nullptr;
-    try {
-        jx9_comm_world = jx9ValueFromJson(comm_world, vm);
-    } catch (...) {
-        jx9_vm_release(vm);
-        throw BEDROCK_DETAILED_EXCEPTION("Could not create Jx9 value for MPI_COMM_WORLD");
-    }
-    ret = jx9_vm_config(vm, JX9_VM_CONFIG_CREATE_VAR, "MPI_COMM_WORLD",
-                        jx9_comm_world);
-    if (ret != JX9_OK) {
-        jx9_release_value(vm, jx9_comm_world);
-        jx9_vm_release(vm);
-        throw BEDROCK_DETAILED_EXCEPTION("Could not install variable \"MPI_COMM_WORLD\" in Jx9 VM");
-    }
-    jx9_release_value(vm, jx9_comm_world);
+    auto vm = program->vm;
 
     // helper lambda to install variables in the VM
-    auto set_variable = [&](const std::string& varname, const std::string& value) {
-        jx9_value* jx9v    = nullptr;
+    auto install_value = [&](const char* varname, const json& value) {
+        jx9_value* jx9v = nullptr;
         try {
-            jx9v = jx9ValueFromJson(json::parse(value), vm);
+            jx9v = jx9ValueFromJson(value, vm);
         } catch (...) {
-            jx9_vm_release(vm);
             throw BEDROCK_DETAILED_EXCEPTION("Could not create Jx9 value from variable \"{}\"",
                             varname);
         }
-        ret = jx9_vm_config(vm, JX9_VM_CONFIG_CREATE_VAR, varname.c_str(),
-                            jx9v);
+        ret = jx9_vm_config(vm, JX9_VM_CONFIG_CREATE_VAR, varname, jx9v);
+        jx9_release_value(vm, jx9v);
         if (ret != JX9_OK) {
-            jx9_release_value(vm, jx9v);
-            jx9_vm_release(vm);
             throw BEDROCK_DETAILED_EXCEPTION("Could not install variable \"{}\" in Jx9 VM",
                             varname);
         }
-        jx9_release_value(vm, jx9v);
+    };
+    auto set_variable = [&](const std::string& varname, const std::string& value) {
+        json parsed;
+        try {
+            parsed = json::parse(value);
+        } catch (...) {
+            throw BEDROCK_DETAILED_EXCEPTION("Could not create Jx9 value from variable \"{}\"",
+                            varname);
+        }
+        install_value(varname.c_str(), parsed);
     };
 
+    // a variable whose name does not appear anywhere in the script can
+    // only be accessed through a dynamically-built name, which we don't
+    // support, so we don't pay for its conversion (e.g. a large __config__
+    // passed to a script that only uses MPI_COMM_WORLD)
+    auto is_referenced = [&script](const std::string& varname) {
+        return script.find(varname) != std::string::npos;
+    };
+
+    // installing MPI_COMM_WORLD (building it requires the addresses of all
+    // the ranks, which are fetched on demand if the addresses were exchanged
+    // lazily); it is reinstalled on every run since the previous run of the
+    // script may have modified it
+    if (is_referenced("MPI_COMM_WORLD")) {
+        install_value("MPI_COMM_WORLD", *self->commWorld());
+    }
+
     // installing VM variables from Jx9Manager
-    for (auto& p : self->m_global_variables) {
-        if(variables.find(p.first) != variables.end())
-            continue;
-        set_variable(p.first, p.second);
+    std::unordered_set<std::string> installed;
+    {
+        std::shared_lock<RWLock> lock(self->m_globals_mtx);
+        for (auto& p : self->m_global_variables) {
+            if(variables.find(p.first) != variables.end())
+                continue;
+            if(!is_referenced(p.first)) continue;
+            set_variable(p.first, p.second);
+            installed.insert(p.first);
+        }
     }
 
     // installing VM variables
     for (auto& p : variables) {
-        set_variable(p.first, p.second);
+        if(!is_referenced(p.first)) continue;
+        install_value(p.first.c_str(), *p.second);
+        installed.insert(p.first);
     }
 
-    // redirect VM output to stdout
-    jx9_vm_config(vm, JX9_VM_CONFIG_OUTPUT,
-                  static_cast<int (*)(const void*, unsigned, void*)>(
-                      [](const void* pOutput, unsigned int nLen, void*) -> int {
-                          auto s = std::string((const char*)pOutput, nLen);
-                          spdlog::info("[jx9] {}", s);
-                          return JX9_OK;
-                      }),
-                  NULL);
-
-    // make errors appear in output
-    jx9_vm_config(vm, JX9_VM_CONFIG_ERR_REPORT);
+    // variables from a previous run that are not provided anymore
+    for (auto& name : program->variables) {
+        if (installed.count(name)) continue;
+        install_value(name.c_str(), nullptr);
+    }
+    program->variables = std::move(installed);
 
     // execute the VM
     int exit_status;
     ret = jx9_vm_exec(vm, &exit_status);
     if (ret != JX9_OK) {
-        jx9_vm_release(vm);
         throw BEDROCK_DETAILED_EXCEPTION("Jx9 VM execution failed with error code {}", ret);
     }
 
@@ -157,7 +199,6 @@ std::string Jx9Manager::executeQuery(
     jx9_value* ret_value;
     ret = jx9_vm_config(vm, JX9_VM_CONFIG_EXEC_VALUE, &ret_value);
     if (ret != JX9_OK) {
-        jx9_vm_release(vm);
         throw BEDROCK_DETAILED_EXCEPTION("Could not extract return value from Jx9 VM");
     }
 
@@ -165,7 +206,8 @@ std::string Jx9Manager::executeQuery(
     int         ret_string_len = 0;
     const char* ret_string = jx9_value_to_string(ret_value, &ret_string_len);
     auto        result     = std::string(ret_string, ret_string_len);
-    jx9_vm_release(vm);
+    program->clearVariables();
+    engine->releaseProgram(std::move(program));
 
     spdlog::trace("Jx9 program returned the following value: {}", result);
 
@@ -182,6 +224,43 @@ bool Jx9Manager::evaluateCondition(
     return result == "true";
 }
 
+std::vector<bool> Jx9Manager::evaluateConditions(
+        const std::vector<std::string>& conditions,
+        const std::unordered_map<std::string, std::string>& variables) const {
+    std::vector<bool> results;
+    if (conditions.empty()) return results;
+    if (conditions.size() == 1) {
+        results.push_back(evaluateCondition(conditions[0], variables));
+        return results;
+    }
+    // the script concatenates one "1" or "0" character per condition
+    std::string query = "return ";
+    for (size_t i = 0; i < conditions.size(); ++i) {
+        if (i != 0) query += " .. ";
+        query += "(((";
+        query += conditions[i];
+        query += ") == true) ? \"1\" : \"0\")";
+    }
+    query += ";";
+    std::string result;
+    try {
+        result = executeQuery(query, variables);
+    } catch (const Exception&) {
+        result.clear();
+    }
+    if (result.size() != conditions.size()
+    ||  result.find_first_not_of("01") != std::string::npos) {
+        // one of the conditions is invalid (or interfered with the
+        // others), evaluate them one by one to report the right error
+        for (auto& condition : conditions)
+            results.push_back(evaluateCondition(condition, variables));
+        return results;
+    }
+    results.reserve(conditions.size());
+    for (auto c : result) results.push_back(c == '1');
+    return results;
+}
+
 static jx9_value* jx9ValueFromJson(const json& object, jx9_vm* vm) {
     jx9_value* v = nullptr;
     switch (object.type()) {
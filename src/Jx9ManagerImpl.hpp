@@ -7,41 +7,264 @@
 #define __BEDROCK_JX9_MANAGER_IMPL_H
 
 #include "jx9/jx9.h"
+#include "MPIEnvImpl.hpp"
+#include "RWLock.hpp"
 #include <thallium.hpp>
 #include <spdlog/spdlog.h>
+#include <nlohmann/json.hpp>
+#include <cctype>
+#include <list>
 #include <memory>
+#include <mutex>
 #include <vector>
 #include <string>
 #include <unordered_map>
+#include <unordered_set>
 #include <bedrock/MPIEnv.hpp>
 
 namespace bedrock {
 
 namespace tl = thallium;
 
-class Jx9ManagerImpl {
+/**
+ * @brief A compiled Jx9 script. The VM is reset and reused when the
+ * same script is executed again. Resetting the VM does not clear its
+ * variables: the ones the script uses (script_variables, the $names
+ * appearing in it) are nulled after each run, and the ones installed
+ * by previous runs are tracked here to be overwritten (or nulled) by
+ * the next run.
+ */
+struct Jx9Program {
+
+    std::string                     script;
+    jx9_vm*                         vm = nullptr;
+    std::vector<std::string>        script_variables;
+    std::unordered_set<std::string> variables;
+
+    Jx9Program(std::string s, jx9_vm* v)
+    : script(std::move(s)), vm(v), script_variables(variableNames(script)) {}
+
+    ~Jx9Program() {
+        if (vm) jx9_vm_release(vm);
+    }
+
+    Jx9Program(const Jx9Program&) = delete;
+    Jx9Program& operator=(const Jx9Program&) = delete;
+
+    /**
+     * @brief Nulls the variables the script used, so that they do not
+     * leak into its next run. Must be called after jx9_vm_exec and
+     * before jx9_vm_reset, the only state in which jx9 gives access
+     * to the VM's variables.
+     */
+    void clearVariables() {
+        for (auto& name : script_variables) {
+            auto value = jx9_vm_extract_variable(vm, name.c_str());
+            if (value) jx9_value_null(value);
+        }
+    }
+
+  private:
+    /* Names following a $ in the script (variables accessed through
+     * dynamically-built names are not supported, see executeQuery). */
+    static std::vector<std::string> variableNames(const std::string& script) {
+        auto is_first = [](char c) { return std::isalpha((unsigned char)c) || c == '_'; };
+        auto is_next  = [](char c) { return std::isalnum((unsigned char)c) || c == '_'; };
+        std::unordered_set<std::string> names;
+        for (size_t i = script.find('$'); i != std::string::npos; i = script.find('$', i)) {
+            size_t j = ++i;
+            if (j == script.size() || !is_first(script[j])) continue;
+            while (j < script.size() && is_next(script[j])) ++j;
+            names.insert(script.substr(i, j - i));
+            i = j;
+        }
+        return {names.begin(), names.end()};
+    }
+};
+
+/**
+ * @brief A Jx9 engine with the programs it compiled. An engine and its
+ * VMs are not thread-safe, so an engine is only ever used by one
+ * execution at a time (see Jx9ManagerImpl::acquireEngine).
+ */
+class Jx9Engine {
+
+    using program_list = std::list<std::unique_ptr<Jx9Program>>;
+
+    // jx9_init and jx9_release modify the library's list of engines and
+    // are called from ULTs, hence an Argobots mutex; it is statically
+    // initialized so that it does not depend on Argobots being initialized
+    // when it is created or still initialized when it is destroyed
+    static inline ABT_mutex_memory s_engines_list_mtx = ABT_MUTEX_INITIALIZER;
+
+    struct EnginesListLock {
+        ABT_mutex mtx = ABT_MUTEX_MEMORY_GET_HANDLE(&s_engines_list_mtx);
+        EnginesListLock() { ABT_mutex_lock(mtx); }
+        ~EnginesListLock() { ABT_mutex_unlock(mtx); }
+    };
 
   public:
-    jx9*                                         m_engine = nullptr;
-    tl::mutex                                    m_mtx;
-    std::unordered_map<std::string, std::string> m_global_variables;
-    MPIEnv                                       m_mpi;
+    jx9*   m_engine = nullptr;
+    size_t m_program_cache_capacity;
 
-    Jx9ManagerImpl(MPIEnv mpi)
-    : m_mpi(std::move(mpi)) {
+    // compiled programs, most recently used first, indexed by script hash
+    program_list                                       m_programs;
+    std::unordered_map<size_t, program_list::iterator> m_programs_by_hash;
+
+    explicit Jx9Engine(size_t program_cache_capacity)
+    : m_program_cache_capacity(program_cache_capacity) {
         spdlog::trace("Initializing Jx9 engine");
+        EnginesListLock lock;
         jx9_init(&m_engine);
     }
 
-    ~Jx9ManagerImpl() {
+    ~Jx9Engine() {
         spdlog::trace("Releasing Jx9 engine");
+        // VMs must be released before their engine
+        m_programs_by_hash.clear();
+        m_programs.clear();
+        EnginesListLock lock;
         jx9_release(m_engine);
     }
 
+    Jx9Engine(const Jx9Engine&) = delete;
+    Jx9Engine& operator=(const Jx9Engine&) = delete;
+
+    /**
+     * @brief Takes the compiled program for this script out of the
+     * cache, or returns nullptr if it isn't cached. The program is
+     * owned by the caller until it is given back with releaseProgram.
+     */
+    std::unique_ptr<Jx9Program> acquireProgram(const std::string& script) {
+        auto it = m_programs_by_hash.find(std::hash<std::string>{}(script));
+        if (it == m_programs_by_hash.end()) return nullptr;
+        if (it->second->get()->script != script) return nullptr; // hash collision
+        auto program = std::move(*(it->second));
+        m_programs.erase(it->second);
+        m_programs_by_hash.erase(it);
+        return program;
+    }
+
+    /**
+     * @brief Puts a program back in the cache after its execution,
+     * evicting the least recently used program if the cache is full.
+     */
+    void releaseProgram(std::unique_ptr<Jx9Program> program) {
+        if (m_program_cache_capacity == 0) return;
+        auto hash = std::hash<std::string>{}(program->script);
+        auto it   = m_programs_by_hash.find(hash);
+        if (it != m_programs_by_hash.end()) {
+            m_programs.erase(it->second);
+            m_programs_by_hash.erase(it);
+        }
+        if (m_programs.size() == m_program_cache_capacity) {
+            auto& last = m_programs.back();
+            m_programs_by_hash.erase(std::hash<std::string>{}(last->script));
+            m_programs.pop_back();
+        }
+        m_programs.push_front(std::move(program));
+        m_programs_by_hash.emplace(hash, m_programs.begin());
+    }
+};
+
+class Jx9ManagerImpl {
+
+  public:
+    mutable RWLock                               m_globals_mtx;
+    std::unordered_map<std::string, std::string> m_global_variables;
+    MPIEnv                                       m_mpi;
+
+    // idle engines, most recently used last
+    tl::mutex                               m_engines_mtx;
+    std::vector<std::unique_ptr<Jx9Engine>> m_idle_engines;
+    size_t                                  m_program_cache_capacity = 64; // per engine
+
+    // MPI_COMM_WORLD, built once addresses have been exchanged
+    tl::mutex                             m_comm_world_mtx;
+    std::shared_ptr<const nlohmann::json> m_comm_world;
+    bool                                  m_comm_world_complete = false;
+
+    Jx9ManagerImpl(MPIEnv mpi)
+    : m_mpi(std::move(mpi)) {
+        // create a first engine so that the common sequential case
+        // never needs to create another one
+        m_idle_engines.push_back(
+            std::make_unique<Jx9Engine>(m_program_cache_capacity));
+    }
+
     Jx9ManagerImpl(const Jx9Manager&) = delete;
     Jx9ManagerImpl(Jx9Manager&&)      = delete;
     Jx9ManagerImpl& operator=(const Jx9Manager&) = delete;
     Jx9ManagerImpl& operator=(Jx9Manager&&) = delete;
+
+    /**
+     * @brief RAII handle giving a ULT exclusive use of an engine,
+     * which goes back to the pool of idle engines when destroyed.
+     */
+    class EngineHandle {
+
+        Jx9ManagerImpl&            m_owner;
+        std::unique_ptr<Jx9Engine> m_engine;
+
+      public:
+
+        EngineHandle(Jx9ManagerImpl& owner, std::unique_ptr<Jx9Engine> engine)
+        : m_owner(owner), m_engine(std::move(engine)) {}
+
+        ~EngineHandle() {
+            std::lock_guard<tl::mutex> lock(m_owner.m_engines_mtx);
+            m_owner.m_idle_engines.push_back(std::move(m_engine));
+        }
+
+        EngineHandle(const EngineHandle&) = delete;
+        EngineHandle& operator=(const EngineHandle&) = delete;
+
+        Jx9Engine* operator->() const { return m_engine.get(); }
+    };
+
+    /**
+     * @brief Takes an idle engine, or creates one if all the engines are
+     * used by concurrent executions. Reusing the most recently released
+     * engine maximizes the chances of finding the script already compiled.
+     */
+    EngineHandle acquireEngine() {
+        std::unique_ptr<Jx9Engine> engine;
+        {
+            std::lock_guard<tl::mutex> lock(m_engines_mtx);
+            if (!m_idle_engines.empty()) {
+                engine = std::move(m_idle_engines.back());
+                m_idle_engines.pop_back();
+            }
+        }
+        if (!engine) engine = std::make_unique<Jx9Engine>(m_program_cache_capacity);
+        return EngineHandle{*this, std::move(engine)};
+    }
+
+    /**
+     * @brief Returns the JSON representation of MPI_COMM_WORLD. It is
+     * rebuilt on each call only until the addresses of the ranks have
+     * been exchanged, and shared read-only by all VMs afterwards.
+     */
+    std::shared_ptr<const nlohmann::json> commWorld() {
+        std::lock_guard<tl::mutex> lock(m_comm_world_mtx);
+#ifdef ENABLE_MPI
+        if (m_mpi.isEnabled() && !m_comm_world_complete) {
+            auto comm_world = nlohmann::json::object();
+            comm_world["rank"] = m_mpi.globalRank();
+            comm_world["size"] = m_mpi.globalSize();
+            comm_world["addresses"] = nlohmann::json::array();
+            for(int i = 0; i < m_mpi.globalSize(); ++i) {
+                comm_world["addresses"].push_back(
+                    m_mpi.self->addressOfRank(i));
+            }
+            m_comm_world          = std::make_shared<const nlohmann::json>(std::move(comm_world));
+            m_comm_world_complete = m_mpi.self->hasAddresses();
+        }
+#endif
+        if (!m_comm_world)
+            m_comm_world = std::make_shared<const nlohmann::json>(nullptr);
+        return m_comm_world;
+    }
 };
 
 } // namespace bedrock
@@ -0,0 +1,87 @@
+/*
+ * (C) 2024 The University of Chicago
+ *
+ * See COPYRIGHT in top-level directory.
+ */
+#ifndef BEDROCK_LRU_CACHE_H
+#define BEDROCK_LRU_CACHE_H
+
+#include <thallium.hpp>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <utility>
+
+namespace bedrock {
+
+namespace tl = thallium;
+
+/**
+ * @brief Thread-safe (in the Argobots sense) least-recently-used cache
+ * with a fixed capacity. A capacity of 0 disables the cache.
+ */
+template <typename Key, typename Value,
+          typename Hash = std::hash<Key>>
+class LRUCache {
+
+    using entry_list = std::list<std::pair<Key, Value>>;
+
+    size_t                                                        m_capacity;
+    entry_list                                                    m_entries; // most recent first
+    std::unordered_map<Key, typename entry_list::iterator, Hash> m_index;
+    mutable tl::mutex                                             m_mtx;
+
+    public:
+
+    explicit LRUCache(size_t capacity)
+    : m_capacity(capacity) {}
+
+    std::optional<Value> get(const Key& key) {
+        std::lock_guard<tl::mutex> lock(m_mtx);
+        auto it = m_index.find(key);
+        if (it == m_index.end()) return std::nullopt;
+        m_entries.splice(m_entries.begin(), m_entries, it->second);
+        return it->second->second;
+    }
+
+    void put(const Key& key, Value value) {
+        std::lock_guard<tl::mutex> lock(m_mtx);
+        if (m_capacity == 0) return;
+        auto it = m_index.find(key);
+        if (it != m_index.end()) {
+            it->second->second = std::move(value);
+            m_entries.splice(m_entries.begin(), m_entries, it->second);
+            return;
+        }
+        if (m_entries.size() == m_capacity) {
+            m_index.erase(m_entries.back().first);
+            m_entries.pop_back();
+        }
+        m_entries.emplace_front(key, std::move(value));
+        m_index.emplace(key, m_entries.begin());
+    }
+
+    void erase(const Key& key) {
+        std::lock_guard<tl::mutex> lock(m_mtx);
+        auto it = m_index.find(key);
+        if (it == m_index.end()) return;
+        m_entries.erase(it->second);
+        m_index.erase(it);
+    }
+
+    void clear() {
+        std::lock_guard<tl::mutex> lock(m_mtx);
+        m_entries.clear();
+        m_index.clear();
+    }
+
+    size_t size() const {
+        std::lock_guard<tl::mutex> lock(m_mtx);
+        return m_entries.size();
+    }
+};
+
+} // namespace bedrock
+
+#endif
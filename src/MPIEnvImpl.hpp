@@ -12,9 +12,19 @@
 #endif
 #include <bedrock/MPIEnv.hpp>
 #include <bedrock/Exception.hpp>
+#include "AddressTable.hpp"
+#include <spdlog/spdlog.h>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <thallium.hpp>
+#include <string>
+#include <unordered_map>
 
 namespace bedrock {
 
+namespace tl = thallium;
+
 struct MPIEnvImpl {
 
 #ifdef ENABLE_MPI
@@ -22,7 +32,24 @@ struct MPIEnvImpl {
     static size_t s_initiaze_mpi_count;
 #endif
 
-    std::vector<std::string> m_addresses;
+    AddressTable m_addresses;
+
+    // addresses materialized from the table, or fetched in lazy mode,
+    // for which a reference was requested (nodes are never moved); in lazy
+    // mode, the mutex also serializes the MPI calls made from any ULT
+    std::unordered_map<int, std::string> m_address_cache;
+    tl::mutex                            m_address_cache_mtx;
+
+#ifdef ENABLE_MPI
+    // level of thread support provided by MPI
+    int                                  m_thread_level = MPI_THREAD_SINGLE;
+    // lazy mode: each process exposes its own address in a window
+    // and the addresses of other ranks are fetched on first use
+    bool                                 m_lazy = false;
+    int                                  m_self_rank = 0;
+    std::string                          m_self_address;
+    MPI_Win                              m_address_win = MPI_WIN_NULL;
+#endif
 
   public:
 
@@ -31,8 +58,11 @@ struct MPIEnvImpl {
         int mpi_is_initialized;
         MPI_Initialized(&mpi_is_initialized);
         if(!mpi_is_initialized) {
-            MPI_Init(nullptr, nullptr);
+            // the lazy address exchange calls MPI from any execution stream
+            MPI_Init_thread(nullptr, nullptr, MPI_THREAD_SERIALIZED, &m_thread_level);
             s_initialized_mpi = true;
+        } else {
+            MPI_Query_thread(&m_thread_level);
         }
         if(s_initialized_mpi)
             s_initiaze_mpi_count += 1;
@@ -41,6 +71,12 @@ struct MPIEnvImpl {
 
     ~MPIEnvImpl() {
 #ifdef ENABLE_MPI
+        // freeing the window is collective, so each process waits for
+        // all the others to be done with their addresses
+        int mpi_is_finalized;
+        MPI_Finalized(&mpi_is_finalized);
+        if(m_address_win != MPI_WIN_NULL && !mpi_is_finalized)
+            MPI_Win_free(&m_address_win);
         if(s_initialized_mpi) {
             s_initiaze_mpi_count -= 1;
             if(s_initiaze_mpi_count == 0) {
@@ -51,27 +87,143 @@ struct MPIEnvImpl {
 #endif
     }
 
-    void exchangeAddresses(const std::string& myaddress) {
+    /**
+     * @brief Builds the table of the addresses of all the processes.
+     * Rank 0 broadcasts its address, from which the processes agree on
+     * the longest prefix shared by all the addresses; only the suffixes
+     * are then gathered, without padding, with an MPI_Allgatherv.
+     */
+    void exchangeAddresses(const std::string& myaddress, bool lazy = false) {
 #ifdef ENABLE_MPI
-        m_addresses.clear();
-        std::string addr = myaddress;
-        int size = addr.size()+1;
-        int max_size = size;
+        if(lazy) {
+            // all the processes must agree, since both modes are collective
+            int supported = m_thread_level >= MPI_THREAD_SERIALIZED;
+            MPI_Allreduce(MPI_IN_PLACE, &supported, 1, MPI_INT, MPI_MIN, MPI_COMM_WORLD);
+            if(supported) {
+                exposeAddress(myaddress);
+                return;
+            }
+            spdlog::warn("MPI does not provide MPI_THREAD_SERIALIZED on all processes, "
+                         "exchanging addresses eagerly");
+        }
         int num_procs;
         MPI_Comm_size(MPI_COMM_WORLD, &num_procs);
-        MPI_Allreduce(&size, &max_size, 1, MPI_INT, MPI_MAX, MPI_COMM_WORLD);
-        addr.resize(max_size, '\0');
-        std::vector<char> allAddresses(max_size*num_procs);
-        MPI_Allgather(addr.data(), addr.size(), MPI_CHAR,
-                      allAddresses.data(), addr.size(), MPI_CHAR, MPI_COMM_WORLD);
-        m_addresses.reserve(num_procs);
+
+        // agree on the common prefix
+        std::string prefix = myaddress;
+        int prefix_size = static_cast<int>(prefix.size());
+        MPI_Bcast(&prefix_size, 1, MPI_INT, 0, MPI_COMM_WORLD);
+        prefix.resize(prefix_size);
+        MPI_Bcast(prefix.data(), prefix_size, MPI_CHAR, 0, MPI_COMM_WORLD);
+        int local_prefix_size = static_cast<int>(
+            AddressTable::commonPrefixLength(prefix, myaddress));
+        MPI_Allreduce(&local_prefix_size, &prefix_size, 1, MPI_INT, MPI_MIN, MPI_COMM_WORLD);
+        prefix.resize(prefix_size);
+
+        // gather the suffixes
+        int suffix_size = static_cast<int>(myaddress.size()) - prefix_size;
+        std::vector<int> sizes(num_procs), displs(num_procs);
+        MPI_Allgather(&suffix_size, 1, MPI_INT, sizes.data(), 1, MPI_INT, MPI_COMM_WORLD);
+        int total_size = 0;
         for(int i = 0; i < num_procs; ++i) {
-            m_addresses.emplace_back(allAddresses.data() + i*max_size);
+            displs[i] = total_size;
+            total_size += sizes[i];
         }
+        std::vector<char> suffixes(total_size);
+        MPI_Allgatherv(myaddress.data() + prefix_size, suffix_size, MPI_CHAR,
+                       suffixes.data(), sizes.data(), displs.data(), MPI_CHAR,
+                       MPI_COMM_WORLD);
+
+        m_addresses = AddressTable{std::move(prefix), suffixes.data(), sizes.data(),
+                                   static_cast<size_t>(num_procs)};
+        spdlog::debug("Address table of {} processes uses {} bytes (common prefix \"{}\")",
+                      num_procs, m_addresses.memoryUsage(), std::string{myaddress, 0, (size_t)prefix_size});
 #else
         (void)myaddress;
+        (void)lazy;
 #endif
     }
+
+    /**
+     * @brief Returns true if the addresses of the other ranks are
+     * available, either in the table or on demand.
+     */
+    bool hasAddresses() const {
+#ifdef ENABLE_MPI
+        if(m_lazy) return true;
+#endif
+        return !m_addresses.empty();
+    }
+
+    /**
+     * @brief Returns the address of the given rank, "<uninitialized>" if
+     * addresses have not been exchanged. The rank is assumed valid.
+     */
+    std::string addressOfRank(int rank) {
+#ifdef ENABLE_MPI
+        if(m_lazy) return cachedAddressOfRank(rank);
+#endif
+        if(m_addresses.empty()) return "<uninitialized>";
+        return m_addresses[rank];
+    }
+
+    /**
+     * @brief Same as addressOfRank, but returns a reference that remains
+     * valid for the lifetime of the MPIEnvImpl. The address is cached
+     * the first time it is requested.
+     */
+    const std::string& cachedAddressOfRank(int rank) {
+        static const std::string uninitialized = "<uninitialized>";
+        if(!hasAddresses()) return uninitialized;
+        std::lock_guard<tl::mutex> lock(m_address_cache_mtx);
+        auto it = m_address_cache.find(rank);
+        if(it != m_address_cache.end()) return it->second;
+#ifdef ENABLE_MPI
+        if(m_lazy) return m_address_cache.emplace(rank, fetchAddress(rank)).first->second;
+#endif
+        return m_address_cache.emplace(rank, m_addresses[rank]).first->second;
+    }
+
+#ifdef ENABLE_MPI
+  private:
+
+    /**
+     * @brief Exposes this process' address, preceded by its size,
+     * in an MPI window (collective). The window's memory is allocated
+     * by MPI and released with the window in the destructor.
+     */
+    void exposeAddress(const std::string& myaddress) {
+        auto  size   = static_cast<uint32_t>(myaddress.size());
+        char* buffer = nullptr;
+        MPI_Win_allocate(sizeof(size) + size, 1, MPI_INFO_NULL,
+                         MPI_COMM_WORLD, &buffer, &m_address_win);
+        std::memcpy(buffer, &size, sizeof(size));
+        std::memcpy(buffer + sizeof(size), myaddress.data(), size);
+        MPI_Comm_rank(MPI_COMM_WORLD, &m_self_rank);
+        m_self_address = myaddress;
+        m_lazy         = true;
+        m_addresses    = AddressTable{};
+        spdlog::debug("Exposed address {} for on-demand rank resolution", myaddress);
+    }
+
+    /**
+     * @brief Reads the address of a rank from its window. Must be called
+     * with m_address_cache_mtx held, so that MPI is called by one thread
+     * at a time (MPI_THREAD_SERIALIZED).
+     */
+    std::string fetchAddress(int rank) {
+        if(rank == m_self_rank) return m_self_address;
+        uint32_t size = 0;
+        MPI_Win_lock(MPI_LOCK_SHARED, rank, 0, m_address_win);
+        MPI_Get(&size, sizeof(size), MPI_BYTE, rank, 0, sizeof(size), MPI_BYTE, m_address_win);
+        MPI_Win_flush(rank, m_address_win);
+        std::string address(size, '\0');
+        MPI_Get(address.data(), size, MPI_BYTE, rank, sizeof(size), size, MPI_BYTE, m_address_win);
+        MPI_Win_unlock(rank, m_address_win);
+        spdlog::trace("Fetched address of rank {}: {}", rank, address);
+        return address;
+    }
+#endif
 };
 
 } // namespace bedrock
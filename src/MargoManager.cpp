@@ -117,6 +117,7 @@ std::shared_ptr<NamedDependency> MargoManager::addPool(const std::string& config
         throw BEDROCK_DETAILED_EXCEPTION(
                 "Could not add pool to Margo instance");
     }
+    self->m_generation += 1;
     return std::make_shared<PoolRef>(self->m_engine, info.name, tl::pool{info.pool});
 }
 
@@ -124,6 +125,7 @@ void MargoManager::removePool(uint32_t index) {
     auto guard = std::unique_lock<tl::mutex>(self->m_mtx);
     try {
         self->m_engine.pools().remove(index);
+        self->m_generation += 1;
     } catch(const tl::exception& ex) {
         throw Exception{"{}", ex.what()};
     }
@@ -133,6 +135,7 @@ void MargoManager::removePool(const std::string& name) {
     auto guard = std::unique_lock<tl::mutex>(self->m_mtx);
     try {
         self->m_engine.pools().remove(name);
+        self->m_generation += 1;
     } catch(const tl::exception& ex) {
         throw Exception{"{}", ex.what()};
     }
@@ -142,6 +145,7 @@ void MargoManager::removePool(ABT_pool pool) {
     auto guard = std::unique_lock<tl::mutex>(self->m_mtx);
     try {
         self->m_engine.pools().remove(tl::pool{pool});
+        self->m_generation += 1;
     } catch(const tl::exception& ex) {
         throw Exception{"{}", ex.what()};
     }
@@ -195,6 +199,7 @@ std::shared_ptr<NamedDependency> MargoManager::addXstream(const std::string& con
         throw BEDROCK_DETAILED_EXCEPTION(
                 "Could not add xstream to Margo instance");
     }
+    self->m_generation += 1;
     return std::make_shared<XstreamRef>(self->m_engine, info.name, tl::xstream{info.xstream});
 }
 
@@ -202,6 +207,7 @@ void MargoManager::removeXstream(uint32_t index) {
     auto guard = std::unique_lock<tl::mutex>(self->m_mtx);
     try {
         self->m_engine.xstreams().remove(index);
+        self->m_generation += 1;
     } catch(const tl::exception& ex) {
         throw Exception{"{}", ex.what()};
     }
@@ -211,6 +217,7 @@ void MargoManager::removeXstream(const std::string& name) {
     auto guard = std::unique_lock<tl::mutex>(self->m_mtx);
     try {
         self->m_engine.xstreams().remove(name);
+        self->m_generation += 1;
     } catch(const tl::exception& ex) {
         throw Exception{"{}", ex.what()};
     }
@@ -220,6 +227,7 @@ void MargoManager::removeXstream(ABT_xstream es) {
     auto guard = std::unique_lock<tl::mutex>(self->m_mtx);
     try {
         self->m_engine.xstreams().remove(tl::xstream{es});
+        self->m_generation += 1;
     } catch(const tl::exception& ex) {
         throw Exception{"{}", ex.what()};
     }
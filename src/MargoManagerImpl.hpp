@@ -9,6 +9,7 @@
 #include <nlohmann/json.hpp>
 #include <margo.h>
 #include <thallium.hpp>
+#include <atomic>
 #include "bedrock/NamedDependency.hpp"
 #include "Formatting.hpp"
 
@@ -57,8 +58,9 @@ struct XstreamRef : public NamedDependency {
 class MargoManagerImpl {
 
   public:
-    tl::mutex  m_mtx;
-    tl::engine m_engine;
+    tl::mutex             m_mtx;
+    tl::engine            m_engine;
+    std::atomic<uint64_t> m_generation{0}; // bumped when pools or xstreams change
 
     json makeConfig() const {
         auto mid = m_engine.get_margo_instance();
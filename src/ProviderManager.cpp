@@ -11,12 +11,16 @@
 
 #include "JsonUtil.hpp"
 #include "ProviderManagerImpl.hpp"
+#include "DependencyFinderImpl.hpp"
 
 #include <thallium/serialization/stl/vector.hpp>
 #include <thallium/serialization/stl/string.hpp>
 #include <spdlog/spdlog.h>
 #include <nlohmann/json.hpp>
 #include <cctype>
+#include <exception>
+#include <unordered_map>
+#include <unordered_set>
 
 namespace tl = thallium;
 
@@ -57,51 +61,70 @@ void ProviderManager::setDependencyFinder(const DependencyFinder& finder) {
 
 std::shared_ptr<ProviderDependency>
 ProviderManager::lookupProvider(const std::string& spec) const {
-    std::lock_guard<tl::mutex> lock(self->m_providers_mtx);
-    auto                       it = self->resolveSpec(spec);
-    if (it == self->m_providers.end())
+    std::shared_lock<RWLock> lock(self->m_providers_mtx);
+    auto                     provider = self->resolveSpec(spec);
+    if (!provider)
         throw BEDROCK_DETAILED_EXCEPTION("Could not find provider with spec \"{}\"", spec);
-    return *it;
+    return provider;
 }
 
 size_t ProviderManager::numProviders() const {
-    std::lock_guard<tl::mutex> lock(self->m_providers_mtx);
+    std::shared_lock<RWLock> lock(self->m_providers_mtx);
     return self->m_providers.size();
 }
 
 std::shared_ptr<ProviderDependency> ProviderManager::getProvider(const std::string& name) const {
-    std::lock_guard<tl::mutex> lock(self->m_providers_mtx);
-    auto                       it = std::find_if(
-        self->m_providers.begin(), self->m_providers.end(),
-        [&name](const auto& p) { return p->getName() == name; });
-    if (it == self->m_providers.end())
+    std::shared_lock<RWLock> lock(self->m_providers_mtx);
+    auto                     it = self->m_providers_by_name.find(name);
+    if (it == self->m_providers_by_name.end())
         throw BEDROCK_DETAILED_EXCEPTION("Could not find provider \"{}\"", name);
-    return *it;
+    return it->second;
 }
 
 std::shared_ptr<ProviderDependency> ProviderManager::getProvider(size_t index) const {
-    std::lock_guard<tl::mutex> lock(self->m_providers_mtx);
+    std::shared_lock<RWLock> lock(self->m_providers_mtx);
     if (index >= self->m_providers.size())
         throw BEDROCK_DETAILED_EXCEPTION("Could not find provider at index {}", index);
     return self->m_providers[index];
 }
 
 void ProviderManager::deregisterProvider(const std::string& spec) {
-    std::lock_guard<tl::mutex> lock(self->m_providers_mtx);
-    auto                       it = self->resolveSpec(spec);
-    if (it == self->m_providers.end()) {
+    std::lock_guard<RWLock> lock(self->m_providers_mtx);
+    auto                    provider = self->resolveSpec(spec);
+    if (!provider) {
         throw BEDROCK_DETAILED_EXCEPTION("Could not find provider for spec \"{}\"", spec);
     }
     spdlog::trace("Deregistering provider {}", spec);
-    self->m_providers.erase(it);
+    self->removeProvider(provider);
 }
 
-std::shared_ptr<ProviderDependency>
-ProviderManager::addProviderFromJSON(const json& description) {
-    if (!self->m_dependency_finder) {
-        throw BEDROCK_DETAILED_EXCEPTION("No DependencyFinder set in ProviderManager");
+namespace {
+
+/**
+ * @brief Appends to specs the dependency specifications of the provider
+ * description that refer to remote providers (i.e. that have a locator).
+ */
+void collectRemoteSpecs(const json& description, std::vector<std::string>& specs) {
+    if (!description.is_object()) return;
+    auto deps = description.find("dependencies");
+    if (deps == description.end() || !deps->is_object()) return;
+    auto add = [&specs](const json& spec) {
+        if (spec.is_string()
+        &&  spec.get_ref<const std::string&>().find('@') != std::string::npos)
+            specs.push_back(spec.get<std::string>());
+    };
+    for (auto& dep : deps->items()) {
+        if (dep.value().is_array()) {
+            for (auto& elem : dep.value()) add(elem);
+        } else {
+            add(dep.value());
+        }
     }
-    auto dependencyFinder = DependencyFinder(self->m_dependency_finder);
+}
+
+} // namespace
+
+void validateProviderDescription(const json& description) {
     static const json configSchema = R"(
     {
         "$schema": "https://json-schema.org/draft/2019-09/schema",
@@ -138,6 +161,21 @@ ProviderManager::addProviderFromJSON(const json& description) {
     )"_json;
     static const JsonValidator validator{configSchema};
     validator.validate(description, "ProviderManager");
+}
+
+std::shared_ptr<ProviderDependency>
+ProviderManager::addProviderFromJSON(const json& description) {
+    return createProvider(description, false);
+}
+
+std::shared_ptr<ProviderDependency>
+ProviderManager::createProvider(const json& description, bool validated) {
+    if (!self->m_dependency_finder) {
+        throw BEDROCK_DETAILED_EXCEPTION("No DependencyFinder set in ProviderManager");
+    }
+    auto dependencyFinder = DependencyFinder(self->m_dependency_finder);
+    ResolutionScope resolution_scope{self->m_dependency_finder};
+    if (!validated) validateProviderDescription(description);
 
     auto& type = description["type"].get_ref<const std::string&>();
     ComponentArgs args;
@@ -153,10 +191,17 @@ ProviderManager::addProviderFromJSON(const json& description) {
                 "Bedrock already uses provider ID {}", args.provider_id);
     }
 
+    StartupReport::Span resolving{self->m_startup_report.get(), args.name, "dependencies"};
     auto deps_from_config = description.value("dependencies", json::object());
     auto requested_dependencies = ModuleManager::getDependencies(type, args);
     auto& resolved_dependency_map = args.dependencies;
 
+    // resolve remote dependencies with one RPC per destination
+    // rather than one RPC per dependency
+    std::vector<std::string> remote_specs;
+    collectRemoteSpecs(description, remote_specs);
+    if (remote_specs.size() > 1) dependencyFinder.prefetch(remote_specs);
+
     for (const auto& dependency : requested_dependencies) {
         spdlog::trace("Resolving dependency {}", dependency.name);
         if (deps_from_config.contains(dependency.name)) {
@@ -198,12 +243,14 @@ ProviderManager::addProviderFromJSON(const json& description) {
                     dependency.name, dependency.type);
         }
     }
+    resolving.end();
 
-    std::shared_ptr<LocalProvider> entry;
+    // reserve the name and provider ID while the component is created,
+    // so that its constructor does not run under m_providers_mtx and
+    // several providers can be instantiated concurrently
     {
-        std::unique_lock<tl::mutex> lock(self->m_providers_mtx);
-        auto                        it = self->resolveSpec(args.name);
-        if (it != self->m_providers.end()) {
+        std::unique_lock<RWLock> lock(self->m_providers_mtx);
+        if (self->resolveSpec(args.name) || self->m_pending_names.count(args.name)) {
             throw BEDROCK_DETAILED_EXCEPTION(
                     "Name \"{}\" already used by another provider", args.name);
         }
@@ -211,38 +258,294 @@ ProviderManager::addProviderFromJSON(const json& description) {
         if (args.provider_id == std::numeric_limits<uint16_t>::max())
             args.provider_id = self->getAvailableProviderID();
 
-        it = std::find_if(self->m_providers.begin(), self->m_providers.end(),
-                [&](const auto& p) { return p->getProviderID() == args.provider_id; });
-        if (it != self->m_providers.end()) {
+        if (self->isProviderIDUsed(args.provider_id)) {
             throw BEDROCK_DETAILED_EXCEPTION(
                     "Another provider already uses provider ID {}", args.provider_id);
         }
 
-        auto handle = ModuleManager::createComponent(type, args);
+        self->reserveProvider(args.name, args.provider_id);
+    }
 
-        entry = std::make_shared<LocalProvider>(
-                args.name, type, args.provider_id, handle,
-                requested_dependencies, args.dependencies, args.tags);
+    ComponentPtr handle;
+    try {
+        StartupReport::Span constructing{self->m_startup_report.get(), args.name, "provider"};
+        handle = ModuleManager::createComponent(type, args);
+    } catch(...) {
+        std::unique_lock<RWLock> lock(self->m_providers_mtx);
+        self->releaseProvider(args.name, args.provider_id);
+        throw;
+    }
 
-        spdlog::trace("Registered provider {} of type {} with provider id {}",
-                args.name, type, args.provider_id);
+    auto entry = std::make_shared<LocalProvider>(
+            args.name, type, args.provider_id, handle,
+            requested_dependencies, args.dependencies, args.tags);
 
-        self->m_providers.push_back(entry);
+    {
+        std::unique_lock<RWLock> lock(self->m_providers_mtx);
+        self->releaseProvider(args.name, args.provider_id);
+        self->insertProvider(entry);
     }
-    self->m_providers_cv.notify_all();
+
+    spdlog::trace("Registered provider {} of type {} with provider id {}",
+            args.name, type, args.provider_id);
+
+    self->notifyProviderAdded(entry);
     return entry;
 }
 
+namespace {
+
+/**
+ * @brief Plan for instantiating a list of providers in topological waves.
+ */
+struct ProviderListPlan {
+    std::vector<json>                descriptions; // with provider IDs assigned
+    std::vector<std::vector<size_t>> waves;        // indices of entries in the list
+};
+
+/**
+ * @brief Builds the dependency graph of a list of provider descriptions
+ * and groups its entries into topological waves. Provider IDs are assigned
+ * upfront, exactly as the sequential path would assign them.
+ *
+ * Returns false if the list cannot be planned statically (duplicate names
+ * or IDs, forward references, ill-formed entries, etc.). The caller then
+ * falls back to the sequential path, which reports errors as it always did.
+ *
+ * @param list List of provider descriptions.
+ * @param used_ids Provider IDs already in use.
+ * @param plan Resulting plan.
+ */
+bool planProviderList(const json& list,
+                      ProviderIDBitmap used_ids,
+                      ProviderListPlan& plan) {
+    const auto max_id = std::numeric_limits<uint16_t>::max();
+    const auto n      = list.size();
+    std::unordered_map<std::string, size_t> index_of_name;
+    std::unordered_map<std::string, size_t> index_of_type_id;
+    plan.descriptions.reserve(n);
+
+    for (size_t i = 0; i < n; ++i) {
+        auto& entry = list[i];
+        if (!entry.is_object()) return false;
+        auto name = entry.find("name");
+        auto type = entry.find("type");
+        if (name == entry.end() || !name->is_string()) return false;
+        if (type == entry.end() || !type->is_string()) return false;
+        if (index_of_name.count(name->get<std::string>())) return false;
+        auto provider_id = entry.value("provider_id", json(max_id));
+        if (!provider_id.is_number_unsigned() || provider_id.get<uint64_t>() > max_id)
+            return false;
+        auto id = provider_id.get<uint16_t>();
+        if (id == max_id) id = used_ids.lowestFree(); // as getAvailableProviderID
+        if (used_ids.test(id)) return false;
+        used_ids.set(id);
+        plan.descriptions.push_back(entry);
+        plan.descriptions.back()["provider_id"] = id;
+        index_of_name[name->get<std::string>()] = i;
+        index_of_type_id[type->get<std::string>() + ":" + std::to_string(id)] = i;
+    }
+
+    // index of the entry a dependency string refers to, n if none;
+    // the locator is ignored so that "name@<own address>" is also
+    // considered a dependency on the entry
+    auto resolve = [&](const std::string& spec) -> size_t {
+        auto identifier = spec.substr(0, spec.find('@'));
+        auto column     = identifier.find(':');
+        if (column == std::string::npos) {
+            auto it = index_of_name.find(identifier);
+            return it == index_of_name.end() ? n : it->second;
+        }
+        auto id_str = identifier.substr(column + 1);
+        if (id_str.empty() || id_str.find_first_not_of("0123456789") != std::string::npos)
+            return n;
+        auto key = identifier.substr(0, column) + ":"
+                 + std::to_string(static_cast<uint16_t>(std::atoi(id_str.c_str())));
+        auto it = index_of_type_id.find(key);
+        return it == index_of_type_id.end() ? n : it->second;
+    };
+
+    std::vector<size_t> wave_of(n, 0);
+    for (size_t i = 0; i < n; ++i) {
+        auto deps = list[i].find("dependencies");
+        if (deps == list[i].end()) continue;
+        if (!deps->is_object()) return false;
+        for (auto& dep : deps->items()) {
+            std::vector<const json*> specs;
+            if (dep.value().is_array()) {
+                for (auto& elem : dep.value()) specs.push_back(&elem);
+            } else {
+                specs.push_back(&dep.value());
+            }
+            for (auto spec : specs) {
+                if (spec->is_number_unsigned()) continue; // pool or xstream index
+                if (!spec->is_string()) return false;
+                auto j = resolve(spec->get_ref<const std::string&>());
+                if (j == n) continue;
+                if (j >= i) return false;
+                wave_of[i] = std::max(wave_of[i], wave_of[j] + 1);
+            }
+        }
+    }
+
+    for (size_t i = 0; i < n; ++i) {
+        if (wave_of[i] >= plan.waves.size()) plan.waves.resize(wave_of[i] + 1);
+        plan.waves[wave_of[i]].push_back(i);
+    }
+    return true;
+}
+
+} // namespace
+
 void ProviderManager::addProviderListFromJSON(const json& list) {
+    createProviderList(list, nullptr, false);
+}
+
+void ProviderManager::addProviderListFromJSON(const json& list,
+                                              std::shared_ptr<NamedDependency> pool) {
+    createProviderList(list, std::move(pool), false);
+}
+
+void ProviderManager::createProviderList(const json& list,
+                                         std::shared_ptr<NamedDependency> pool,
+                                         bool validated) {
     if (list.is_null()) { return; }
     if (!list.is_array()) {
         throw BEDROCK_DETAILED_EXCEPTION(
             "Invalid JSON configuration passed to "
             "ProviderManager::addProviderListFromJSON (should be an array)");
     }
-    for (const auto& provider : list) {
-        addProviderFromJSON(provider);
+
+    // resolve the remote dependencies of all the providers at once
+    ResolutionScope resolution_scope{self->m_dependency_finder};
+    if (self->m_dependency_finder) {
+        std::vector<std::string> remote_specs;
+        for (const auto& provider : list) collectRemoteSpecs(provider, remote_specs);
+        if (!remote_specs.empty()) {
+            StartupReport::Span prefetching{self->m_startup_report.get(),
+                                            "remote dependencies", "dependencies"};
+            DependencyFinder(self->m_dependency_finder).prefetch(remote_specs);
+        }
     }
+
+    ProviderListPlan plan;
+    bool parallel = pool && list.size() > 1;
+    if (parallel) {
+        ProviderIDBitmap used_ids;
+        {
+            std::shared_lock<RWLock> lock(self->m_providers_mtx);
+            used_ids = self->m_used_provider_ids;
+        }
+        parallel = planProviderList(list, std::move(used_ids), plan);
+        if (!parallel)
+            spdlog::debug("Providers cannot be instantiated concurrently, "
+                          "falling back to sequential instantiation");
+    }
+
+    if (!parallel) {
+        for (const auto& provider : list) {
+            createProvider(provider, validated);
+        }
+        return;
+    }
+
+    // Entries are only started if they come before the first failure
+    // (in list order). Since dependencies always point backward, all the
+    // entries the sequential path would have created do get created.
+    // Entries of the same wave that come after the failure may however
+    // already have been created; they are removed once the wave completes.
+    {
+        std::lock_guard<RWLock> lock(self->m_providers_mtx);
+        self->m_lists_in_progress += 1;
+    }
+    const auto n       = list.size();
+    auto       tl_pool = pool->getHandle<tl::pool>();
+    std::vector<std::shared_ptr<ProviderDependency>> created(n);
+    std::vector<std::exception_ptr>                  errors(n);
+    size_t first_error = n;
+    spdlog::trace("Instantiating {} providers in {} waves", n, plan.waves.size());
+    for (const auto& wave : plan.waves) {
+        std::vector<tl::managed<tl::thread>> ults;
+        ults.reserve(wave.size());
+        for (auto i : wave) {
+            if (i > first_error) break;
+            ults.push_back(tl_pool.make_thread([this, i, validated, &plan, &created, &errors]() {
+                try {
+                    created[i] = createProvider(plan.descriptions[i], validated);
+                } catch (...) {
+                    errors[i] = std::current_exception();
+                }
+            }));
+        }
+        for (auto& ult : ults) ult->join();
+        for (auto i : wave)
+            if (errors[i] && i < first_error) first_error = i;
+    }
+
+    {
+        std::lock_guard<RWLock> lock(self->m_providers_mtx);
+        auto& providers = self->m_providers;
+        std::unordered_map<const ProviderDependency*, size_t> index_of;
+        for (size_t i = 0; i < n; ++i)
+            if (created[i]) index_of[created[i].get()] = i;
+        // remove the providers that the sequential path would not have created
+        for (size_t i = first_error + 1; i < n; ++i) {
+            if (!created[i]) continue;
+            self->removeProvider(std::static_pointer_cast<LocalProvider>(created[i]));
+            index_of.erase(created[i].get());
+        }
+        // put the remaining ones back in list order
+        std::vector<size_t>                         positions;
+        std::vector<std::shared_ptr<LocalProvider>> sorted;
+        for (size_t k = 0; k < providers.size(); ++k) {
+            if (!index_of.count(providers[k].get())) continue;
+            positions.push_back(k);
+            sorted.push_back(providers[k]);
+        }
+        std::sort(sorted.begin(), sorted.end(),
+            [&index_of](const auto& a, const auto& b) {
+                return index_of[a.get()] < index_of[b.get()];
+            });
+        for (size_t k = 0; k < positions.size(); ++k)
+            providers[positions[k]] = std::move(sorted[k]);
+        // publish the changes as a single generation bump
+        self->m_lists_in_progress -= 1;
+        if (!self->m_lists_in_progress && self->m_generation_pending) {
+            self->m_generation_pending = false;
+            self->m_generation += 1;
+        }
+    }
+
+    if (first_error != n) std::rethrow_exception(errors[first_error]);
+}
+
+std::vector<RequestResult<uint16_t>>
+ProviderManager::createProviderBatch(const json& list) {
+    if (!list.is_array()) {
+        throw BEDROCK_DETAILED_EXCEPTION(
+            "Invalid list of providers passed to bedrock_start_providers "
+            "(should be an array)");
+    }
+
+    // resolve the remote dependencies of the whole batch at once
+    ResolutionScope resolution_scope{self->m_dependency_finder};
+    if (self->m_dependency_finder) {
+        std::vector<std::string> remote_specs;
+        for (const auto& provider : list) collectRemoteSpecs(provider, remote_specs);
+        if (!remote_specs.empty())
+            DependencyFinder(self->m_dependency_finder).prefetch(remote_specs);
+    }
+
+    std::vector<RequestResult<uint16_t>> results(list.size());
+    for (size_t i = 0; i < list.size(); ++i) {
+        try {
+            results[i].value() = createProvider(list[i], false)->getProviderID();
+        } catch (const std::exception& ex) {
+            results[i].success() = false;
+            results[i].error()   = ex.what();
+        }
+    }
+    return results;
 }
 
 void ProviderManager::migrateProvider(
@@ -251,12 +554,12 @@ void ProviderManager::migrateProvider(
         uint16_t           dest_provider_id,
         const std::string& migration_config,
         bool               remove_source) {
-    // find the provider
-    std::lock_guard<tl::mutex> lock(self->m_providers_mtx);
-    auto                       it = self->resolveSpec(provider);
-    if (it == self->m_providers.end())
+    // find the provider and pin it, without blocking the provider table
+    auto entry = self->findProvider(provider);
+    if (!entry)
         throw BEDROCK_DETAILED_EXCEPTION("Provider with spec \"{}\" not found", provider);
-    ComponentPtr theProvider = (*it)->getHandle<ComponentPtr>();
+    std::lock_guard<tl::mutex> lock(entry->operation_mtx);
+    ComponentPtr theProvider = entry->getHandle<ComponentPtr>();
     try {
         theProvider->migrate(
                 dest_addr.c_str(), dest_provider_id,
@@ -265,6 +568,8 @@ void ProviderManager::migrateProvider(
     } catch(const std::exception& ex) {
         throw Exception{ex.what()};
     }
+    // the operation may have changed the provider's configuration
+    self->m_generation += 1;
 }
 
 void ProviderManager::snapshotProvider(
@@ -272,12 +577,12 @@ void ProviderManager::snapshotProvider(
         const std::string& dest_path,
         const std::string& snapshot_config,
         bool               remove_source) {
-    // find the provider
-    std::lock_guard<tl::mutex> lock(self->m_providers_mtx);
-    auto                       it = self->resolveSpec(provider);
-    if (it == self->m_providers.end())
+    // find the provider and pin it, without blocking the provider table
+    auto entry = self->findProvider(provider);
+    if (!entry)
         throw BEDROCK_DETAILED_EXCEPTION("Provider with spec \"{}\" not found", provider);
-    ComponentPtr theProvider = (*it)->getHandle<ComponentPtr>();
+    std::lock_guard<tl::mutex> lock(entry->operation_mtx);
+    ComponentPtr theProvider = entry->getHandle<ComponentPtr>();
     try {
         theProvider->snapshot(
             dest_path.c_str(),
@@ -286,18 +591,20 @@ void ProviderManager::snapshotProvider(
     } catch(const std::exception& ex) {
         throw Exception{ex.what()};
     }
+    // the operation may have changed the provider's configuration
+    self->m_generation += 1;
 }
 
 void ProviderManager::restoreProvider(
         const std::string& provider,
         const std::string& src_path,
         const std::string& restore_config) {
-    // find the provider
-    std::lock_guard<tl::mutex> lock(self->m_providers_mtx);
-    auto                       it = self->resolveSpec(provider);
-    if (it == self->m_providers.end())
+    // find the provider and pin it, without blocking the provider table
+    auto entry = self->findProvider(provider);
+    if (!entry)
         throw BEDROCK_DETAILED_EXCEPTION("Provider with spec \"{}\" not found", provider);
-    ComponentPtr theProvider = (*it)->getHandle<ComponentPtr>();
+    std::lock_guard<tl::mutex> lock(entry->operation_mtx);
+    ComponentPtr theProvider = entry->getHandle<ComponentPtr>();
     try {
         theProvider->restore(
             src_path.c_str(),
@@ -305,6 +612,14 @@ void ProviderManager::restoreProvider(
     } catch(const std::exception& ex) {
         throw Exception{ex.what()};
     }
+    // the operation may have changed the provider's configuration
+    self->m_generation += 1;
+}
+
+void ProviderManager::invalidateConfig() {
+    std::lock_guard<RWLock> lock(self->m_providers_mtx);
+    self->bumpGeneration();
+    self->m_modules_generation += 1;
 }
 
 json ProviderManager::getCurrentConfig() const {
@@ -7,6 +7,9 @@
 #define __BEDROCK_PROVIDER_MANAGER_IMPL_H
 
 #include "MargoManagerImpl.hpp"
+#include "Encoding.hpp"
+#include "RWLock.hpp"
+#include "StartupReport.hpp"
 #include "bedrock/DependencyFinder.hpp"
 #include "bedrock/DependencyMap.hpp"
 #include "bedrock/RequestResult.hpp"
@@ -23,6 +26,14 @@
 #include <spdlog/spdlog.h>
 
 #include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <ctime>
+#include <limits>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+#include <unordered_set>
 
 namespace bedrock {
 
@@ -37,6 +48,7 @@ class LocalProvider : public ProviderDependency {
     std::vector<Dependency>  requested_dependencies;
     ResolvedDependencyMap    resolved_dependencies;
     std::vector<std::string> tags;
+    tl::mutex                operation_mtx; // serializes migrate/snapshot/restore
 
     LocalProvider(
             std::string name, std::string type, uint16_t provider_id, ComponentPtr ptr,
@@ -76,6 +88,67 @@ class LocalProvider : public ProviderDependency {
     }
 };
 
+/**
+ * @brief A lookup RPC waiting for a provider to be registered.
+ */
+struct ProviderLookupWaiter {
+    tl::condition_variable         cv;
+    std::shared_ptr<LocalProvider> provider;
+};
+
+/**
+ * @brief Bitmap of provider IDs in use, keeping track of the lowest
+ * free ID so that allocating an ID does not require a full scan.
+ */
+class ProviderIDBitmap {
+
+    static constexpr size_t num_ids = size_t{std::numeric_limits<uint16_t>::max()} + 1;
+
+    std::vector<uint64_t> m_bits = std::vector<uint64_t>(num_ids / 64, 0);
+    size_t                m_lowest_free = 0; // all IDs below are in use
+
+    public:
+
+    bool test(uint16_t id) const {
+        return (m_bits[id / 64] >> (id % 64)) & 1;
+    }
+
+    void set(uint16_t id) {
+        m_bits[id / 64] |= (uint64_t{1} << (id % 64));
+    }
+
+    void reset(uint16_t id) {
+        m_bits[id / 64] &= ~(uint64_t{1} << (id % 64));
+        if (id < m_lowest_free) m_lowest_free = id;
+    }
+
+    /**
+     * @brief Returns the lowest ID that is not in use, excluding
+     * 65534 and 65535, or 0 if there is none. The returned ID
+     * is not marked as used.
+     */
+    uint16_t lowestFree() {
+        const size_t max = std::numeric_limits<uint16_t>::max() - 1;
+        size_t       i   = m_lowest_free;
+        while (i < max) {
+            auto word = ~m_bits[i / 64] >> (i % 64);
+            if (word) {
+                i += __builtin_ctzll(word);
+                break;
+            }
+            i = (i / 64 + 1) * 64;
+        }
+        m_lowest_free = std::min(i, max);
+        return m_lowest_free < max ? m_lowest_free : 0;
+    }
+};
+
+/**
+ * @brief Validates a provider description against its JSON schema,
+ * throwing an Exception if it is invalid.
+ */
+void validateProviderDescription(const nlohmann::json& description);
+
 class ProviderManagerImpl
 : public tl::provider<ProviderManagerImpl>,
   public std::enable_shared_from_this<ProviderManagerImpl> {
@@ -83,15 +156,31 @@ class ProviderManagerImpl
   public:
     std::shared_ptr<DependencyFinderImpl>       m_dependency_finder;
     std::vector<std::shared_ptr<LocalProvider>> m_providers;
-    mutable tl::mutex                           m_providers_mtx;
-    mutable tl::condition_variable              m_providers_cv;
+    std::unordered_map<std::string, std::shared_ptr<LocalProvider>>
+                                                m_providers_by_name;
+    std::unordered_map<uint16_t, std::shared_ptr<LocalProvider>>
+                                                m_providers_by_id;
+    ProviderIDBitmap                            m_used_provider_ids; // including pending ones
+    std::unordered_set<std::string>             m_pending_names;
+    std::unordered_set<uint16_t>                m_pending_ids;
+    mutable RWLock                              m_providers_mtx; // protects all of the above
+    std::unordered_multimap<std::string, ProviderLookupWaiter*>
+                                                m_lookup_waiters; // keyed by normalized spec
+    mutable tl::mutex                           m_lookup_waiters_mtx;
+    std::atomic<uint64_t>                       m_generation{0}; // bumped when providers change
+    unsigned                                    m_lists_in_progress = 0; // parallel provider lists
+    bool                                        m_generation_pending = false;
+    std::atomic<uint64_t>                       m_modules_generation{0}; // bumped when modules are loaded
 
     std::shared_ptr<MargoManagerImpl> m_margo_manager;
     std::shared_ptr<Jx9ManagerImpl>   m_jx9_manager;
+    std::shared_ptr<StartupReport>    m_startup_report; // only set while the server starts
 
     tl::auto_remote_procedure m_lookup_provider;
+    tl::auto_remote_procedure m_lookup_providers;
     tl::auto_remote_procedure m_load_module;
     tl::auto_remote_procedure m_start_provider;
+    tl::auto_remote_procedure m_start_providers;
     tl::auto_remote_procedure m_migrate_provider;
     tl::auto_remote_procedure m_snapshot_provider;
     tl::auto_remote_procedure m_restore_provider;
@@ -101,10 +190,14 @@ class ProviderManagerImpl
     : tl::provider<ProviderManagerImpl>(engine, provider_id),
       m_lookup_provider(define("bedrock_lookup_provider",
                                &ProviderManagerImpl::lookupProviderRPC, pool)),
+      m_lookup_providers(define("bedrock_lookup_providers",
+                                &ProviderManagerImpl::lookupProvidersRPC, pool)),
       m_load_module(define("bedrock_load_module",
                            &ProviderManagerImpl::loadModuleRPC, pool)),
       m_start_provider(define("bedrock_start_provider",
                               &ProviderManagerImpl::startProviderRPC, pool)),
+      m_start_providers(define("bedrock_start_providers",
+                               &ProviderManagerImpl::startProvidersRPC, pool)),
       m_migrate_provider(define("bedrock_migrate_provider",
                                  &ProviderManagerImpl::migrateProviderRPC, pool)),
       m_snapshot_provider(define("bedrock_snapshot_provider",
@@ -112,6 +205,7 @@ class ProviderManagerImpl
       m_restore_provider(define("bedrock_restore_provider",
                                  &ProviderManagerImpl::restoreProviderRPC, pool))
     {
+        m_used_provider_ids.set(provider_id);
         spdlog::trace("ProviderManagerImpl initialized");
     }
 
@@ -119,47 +213,143 @@ class ProviderManagerImpl
         spdlog::trace("ProviderManagerImpl destroyed");
     }
 
-    uint16_t getAvailableProviderID() const {
-        std::unordered_set<uint16_t> used_provider_ids;
-        used_provider_ids.insert(get_provider_id());
-        for(auto& p : m_providers) {
-            used_provider_ids.insert(p->getProviderID());
-        }
-        for(uint16_t i=0; i < std::numeric_limits<uint16_t>::max()-1; ++i) {
-            if(used_provider_ids.find(i) == used_provider_ids.end())
-                return i;
+    uint16_t getAvailableProviderID() {
+        return m_used_provider_ids.lowestFree();
+    }
+
+    bool isProviderIDUsed(uint16_t provider_id) const {
+        return m_providers_by_id.count(provider_id) || m_pending_ids.count(provider_id);
+    }
+
+    void reserveProvider(const std::string& name, uint16_t provider_id) {
+        m_pending_names.insert(name);
+        m_pending_ids.insert(provider_id);
+        m_used_provider_ids.set(provider_id);
+    }
+
+    void releaseProvider(const std::string& name, uint16_t provider_id) {
+        m_pending_names.erase(name);
+        m_pending_ids.erase(provider_id);
+        if (provider_id != get_provider_id() && !m_providers_by_id.count(provider_id))
+            m_used_provider_ids.reset(provider_id);
+    }
+
+    void insertProvider(std::shared_ptr<LocalProvider> provider) {
+        m_used_provider_ids.set(provider->getProviderID());
+        m_providers_by_name[provider->getName()] = provider;
+        m_providers_by_id[provider->getProviderID()] = provider;
+        m_providers.push_back(std::move(provider));
+        bumpGeneration();
+    }
+
+    void removeProvider(const std::shared_ptr<LocalProvider>& provider) {
+        if (provider->getProviderID() != get_provider_id())
+            m_used_provider_ids.reset(provider->getProviderID());
+        m_providers_by_name.erase(provider->getName());
+        m_providers_by_id.erase(provider->getProviderID());
+        m_providers.erase(std::find(m_providers.begin(), m_providers.end(), provider));
+        bumpGeneration();
+    }
+
+    /* Must be called with m_providers_mtx locked. While a provider list is
+     * being instantiated in parallel, the bump is deferred to the end of the
+     * list, so that the intermediate states (including providers that end up
+     * rolled back) are never picked up as a new configuration generation. */
+    void bumpGeneration() {
+        if (m_lists_in_progress) m_generation_pending = true;
+        else m_generation += 1;
+    }
+
+    std::shared_ptr<LocalProvider> resolveSpec(const std::string& type,
+                                               uint16_t provider_id) const {
+        // provider IDs are unique across types
+        auto it = m_providers_by_id.find(provider_id);
+        if (it == m_providers_by_id.end() || it->second->getType() != type)
+            return nullptr;
+        return it->second;
+    }
+
+    std::shared_ptr<LocalProvider> findProvider(const std::string& spec) const {
+        std::shared_lock<RWLock> lock(m_providers_mtx);
+        return resolveSpec(spec);
+    }
+
+    /**
+     * @brief Normalizes a spec so that a "type:id" spec always gives the same
+     * key as the provider it designates, regardless of how the id is written.
+     */
+    static std::string normalizeSpec(const std::string& spec) {
+        auto column = spec.find(':');
+        if (column == std::string::npos) return spec;
+        uint16_t provider_id = atoi(spec.c_str() + column + 1);
+        return spec.substr(0, column + 1) + std::to_string(provider_id);
+    }
+
+    /**
+     * @brief Wakes up the lookups waiting for this provider, by name or by type:id.
+     */
+    void notifyProviderAdded(const std::shared_ptr<LocalProvider>& provider) {
+        std::lock_guard<tl::mutex> lock(m_lookup_waiters_mtx);
+        if (m_lookup_waiters.empty()) return;
+        auto keys = {provider->getName(),
+                     provider->getType() + ":" + std::to_string(provider->getProviderID())};
+        for (auto& key : keys) {
+            auto range = m_lookup_waiters.equal_range(key);
+            for (auto it = range.first; it != range.second; ++it) {
+                it->second->provider = provider;
+                it->second->cv.notify_one();
+            }
         }
-        return 0;
     }
 
-    auto resolveSpec(const std::string& type, uint16_t provider_id) {
-        return std::find_if(m_providers.begin(), m_providers.end(),
-                            [&type, &provider_id](const auto& p) {
-                                return p->getType() == type
-                                    && p->getProviderID() == provider_id;
-                            });
+    /**
+     * @brief Waits until a provider matching the spec is registered,
+     * or the timeout (in seconds) expires, whichever comes first.
+     * Returns nullptr in the latter case.
+     */
+    std::shared_ptr<LocalProvider> waitForProvider(const std::string& spec,
+                                                   double timeout) {
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        double seconds = std::floor(timeout);
+        deadline.tv_sec  += static_cast<time_t>(seconds);
+        deadline.tv_nsec += static_cast<long>((timeout - seconds) * 1e9);
+        if (deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_sec  += 1;
+            deadline.tv_nsec -= 1000000000L;
+        }
+
+        std::unique_lock<tl::mutex> lock(m_lookup_waiters_mtx);
+        // checking again under m_lookup_waiters_mtx ensures that
+        // a provider registered in the meantime is not missed
+        auto provider = findProvider(spec);
+        if (provider) return provider;
+
+        ProviderLookupWaiter waiter;
+        auto it = m_lookup_waiters.emplace(normalizeSpec(spec), &waiter);
+        while (!waiter.provider) {
+            if (!waiter.cv.wait_until(lock, &deadline)) break; // timed out
+        }
+        m_lookup_waiters.erase(it);
+        return waiter.provider;
     }
 
-    auto resolveSpec(const std::string& spec) {
-        auto                          column = spec.find(':');
-        decltype(m_providers.begin()) it;
+    std::shared_ptr<LocalProvider> resolveSpec(const std::string& spec) const {
+        auto column = spec.find(':');
         if (column == std::string::npos) {
-            it = std::find_if(m_providers.begin(), m_providers.end(),
-                              [&spec](const auto& p) {
-                                  return p->getName() == spec;
-                              });
+            auto it = m_providers_by_name.find(spec);
+            return it == m_providers_by_name.end() ? nullptr : it->second;
         } else {
             auto     type            = spec.substr(0, column);
             auto     provider_id_str = spec.substr(column + 1);
             uint16_t provider_id     = atoi(provider_id_str.c_str());
-            it                       = resolveSpec(type, provider_id);
+            return resolveSpec(type, provider_id);
         }
-        return it;
     }
 
     json makeConfig() const {
-        auto                       config = json::array();
-        std::lock_guard<tl::mutex> lock(m_providers_mtx);
+        auto                     config = json::array();
+        std::shared_lock<RWLock> lock(m_providers_mtx);
         for (auto& p : m_providers) { config.push_back(p->makeConfig()); }
         return config;
     }
@@ -167,35 +357,53 @@ class ProviderManagerImpl
   private:
     void lookupProviderRPC(const tl::request& req, const std::string& spec,
                            double timeout) {
-        double  t1 = tl::timer::wtime();
         RequestResult<ProviderDescriptor> result;
         tl::auto_respond<decltype(result)> auto_respond_with{req, result};
-        std::unique_lock<tl::mutex> lock(m_providers_mtx);
-        auto it = resolveSpec(spec);
-        if (it == m_providers.end() && timeout > 0) {
-            m_providers_cv.wait(lock, [this, &spec, t1, timeout, &it]() {
-                // FIXME doesn't wake up when timeout passes
-                double t2 = tl::timer::wtime();
-                it = resolveSpec(spec);
-                return (t2 - t1 > timeout) || (it != m_providers.end());
-            });
-        }
-        if (it != m_providers.end()) {
-            auto& provider = *it;
+        auto provider = findProvider(spec);
+        if (!provider && timeout > 0) provider = waitForProvider(spec, timeout);
+        if (provider) {
             result.value().name = provider->getName();
             result.value().provider_id = provider->getProviderID();
         } else {
+            result.success() = false;
             result.error()
                 = "Could not find provider with spec \""s + spec + "\"";
         }
     }
 
+    void lookupProvidersRPC(const tl::request& req,
+                            const std::vector<std::string>& specs,
+                            double timeout) {
+        // the timeout applies to the whole batch
+        double deadline = tl::timer::wtime() + timeout;
+        std::vector<RequestResult<ProviderDescriptor>> results(specs.size());
+        tl::auto_respond<decltype(results)> auto_respond_with{req, results};
+        for (size_t i = 0; i < specs.size(); ++i) {
+            auto& spec     = specs[i];
+            auto  provider = findProvider(spec);
+            if (!provider) {
+                double remaining = deadline - tl::timer::wtime();
+                if (remaining > 0) provider = waitForProvider(spec, remaining);
+            }
+            if (provider) {
+                results[i].value().name        = provider->getName();
+                results[i].value().type        = provider->getType();
+                results[i].value().provider_id = provider->getProviderID();
+            } else {
+                results[i].success() = false;
+                results[i].error()
+                    = "Could not find provider with spec \""s + spec + "\"";
+            }
+        }
+    }
+
     void loadModuleRPC(const tl::request& req,
                        const std::string& path) {
         RequestResult<bool> result;
         tl::auto_respond<decltype(result)> auto_respond_with{req, result};
         try {
             ModuleManager::loadModule(path);
+            m_modules_generation += 1;
             result.success() = true;
             result.value()   = true;
         } catch (const Exception& e) {
@@ -217,6 +425,20 @@ class ProviderManagerImpl
         }
     }
 
+    void startProvidersRPC(const tl::request& req, uint8_t encoding,
+                           const std::string& descriptions) {
+        RequestResult<std::vector<RequestResult<uint16_t>>> result;
+        tl::auto_respond<decltype(result)> auto_respond_with{req, result};
+        auto manager = ProviderManager(shared_from_this());
+        try {
+            auto list = decodeJSON(descriptions, encodingFromValue(encoding));
+            result.value() = manager.createProviderBatch(list);
+        } catch (std::exception& ex) {
+            result.success() = false;
+            result.error()   = ex.what();
+        }
+    }
+
     void migrateProviderRPC(const tl::request& req,
                             const std::string& name,
                             const std::string& dest_addr,
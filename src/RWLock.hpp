@@ -0,0 +1,34 @@
+/*
+ * (C) 2024 The University of Chicago
+ *
+ * See COPYRIGHT in top-level directory.
+ */
+#ifndef BEDROCK_RWLOCK_H
+#define BEDROCK_RWLOCK_H
+
+#include <thallium.hpp>
+
+namespace bedrock {
+
+namespace tl = thallium;
+
+/**
+ * @brief Wrapper around a tl::rwlock exposing the SharedMutex
+ * interface, so that it can be used with std::shared_lock
+ * (readers) and std::unique_lock/std::lock_guard (writers).
+ */
+class RWLock {
+
+    tl::rwlock m_rwlock;
+
+    public:
+
+    void lock() { m_rwlock.wrlock(); }
+    void unlock() { m_rwlock.unlock(); }
+    void lock_shared() { m_rwlock.rdlock(); }
+    void unlock_shared() { m_rwlock.unlock(); }
+};
+
+} // namespace bedrock
+
+#endif
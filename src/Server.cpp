@@ -14,9 +14,13 @@
 #include "ServerImpl.hpp"
 #include "JsonUtil.hpp"
 #include "TomlUtil.hpp"
+#include "StartupReport.hpp"
+#include "Encoding.hpp"
 #include <spdlog/spdlog.h>
 #include <fmt/format.h>
+#include <algorithm>
 #include <fstream>
+#include <future>
 
 namespace tl = thallium;
 
@@ -25,20 +29,45 @@ namespace bedrock {
 using namespace std::string_literals;
 using nlohmann::json;
 
-Server::Server(const std::string& address, const std::string& configString,
-               ConfigType configType, const Jx9ParamMap& jx9Params) {
+namespace {
 
-    std::string configStr;
+/**
+ * @brief Writes the startup report as a Chrome trace-event file.
+ * With more than one MPI process, the rank is appended to the file name.
+ * Failing to write the file is not a fatal error.
+ */
+void writeStartupTrace(const StartupReport& report, std::string filename,
+                       const MPIEnv& mpi) {
+    int rank = 0;
+    if (mpi.isEnabled() && mpi.globalSize() > 1) {
+        rank = mpi.globalRank();
+        filename += "." + std::to_string(rank);
+    }
+    std::ofstream ofs(filename);
+    if (!ofs) {
+        spdlog::error("Could not open {} to write the startup trace", filename);
+        return;
+    }
+    ofs << report.toChromeTrace(rank).dump();
+    spdlog::debug("Startup trace written to {}", filename);
+}
 
-    auto mpi = MPIEnv{};
+/**
+ * @brief Turns a JSON, Jx9 or TOML configuration into a JSON document,
+ * expanding simplified keys and filtering __if__ conditions.
+ */
+json resolveConfig(const std::string& configString, ConfigType configType,
+                   const Jx9ParamMap& jx9Params, const Jx9Manager& jx9Manager,
+                   StartupReport& report) {
 
-    auto jx9Manager = Jx9Manager{mpi};
+    std::string configStr;
 
     if(configType == ConfigType::JX9) {
         spdlog::trace("Interpreting JX9 template configuration");
         configStr = jx9Manager.executeQuery(configString, jx9Params);
         configType = ConfigType::JSON;
         spdlog::trace("JX9 template configuration interpreted");
+        report.phase("jx9");
     } else { // JSON or TOML
         configStr = configString;
     }
@@ -68,9 +97,59 @@ Server::Server(const std::string& address, const std::string& configString,
         }
         config = Toml2Json(tomlConfig);
     }
+    report.phase("parse");
 
     // Filter __if__ statements in configuration
-    config = filterIfConditionsInJSON(config, jx9Manager);
+    filterIfConditionsInJSON(config, jx9Manager);
+    report.phase("__if__ filtering");
+
+    return config;
+}
+
+/**
+ * @brief Compiled configurations are the CBOR encoding of
+ * {"bedrock_compiled_config": <version>, "config": <configuration>}.
+ */
+constexpr const char* compiledConfigMarker  = "bedrock_compiled_config";
+constexpr int         compiledConfigVersion = 1;
+
+json loadCompiledConfig(const std::string& content) {
+    json document;
+    try {
+        document = decodeJSON(content, Encoding::CBOR);
+    } catch(const std::exception& ex) {
+        throw Exception("Invalid compiled configuration: {}", ex.what());
+    }
+    auto marker = document.find(compiledConfigMarker);
+    if(marker == document.end() || *marker != compiledConfigVersion
+    || !document.contains("config")) {
+        throw Exception("Invalid compiled configuration (expected version {} "
+                        "produced by Server::compileConfig)", compiledConfigVersion);
+    }
+    return std::move(document["config"]);
+}
+
+} // namespace
+
+Server::Server(const std::string& address, const std::string& configString,
+               ConfigType configType, const Jx9ParamMap& jx9Params) {
+
+    auto report = std::make_shared<StartupReport>();
+
+    auto mpi = MPIEnv{};
+
+    auto jx9Manager = Jx9Manager{mpi};
+
+    // A compiled configuration has already been resolved and validated
+    json config;
+    bool compiled = configType == ConfigType::COMPILED;
+    if(compiled) {
+        spdlog::trace("Loading compiled configuration");
+        config = loadCompiledConfig(configString);
+        report->phase("load compiled config");
+    } else {
+        config = resolveConfig(configString, configType, jx9Params, jx9Manager, *report);
+    }
 
     // If the config is an array, it should have only one entry remaining after filtering
     if(config.is_array()) {
@@ -89,6 +168,34 @@ Server::Server(const std::string& address, const std::string& configString,
         }
     }
 
+    // Load the modules while Margo initializes and addresses are exchanged,
+    // since dlopen-ing libraries does not depend on Margo. This runs in a
+    // std::thread because Argobots is not initialized yet. If this thread
+    // throws, the exception is rethrown when joining it, where modules used
+    // to be loaded. If Margo fails to initialize, the future's destructor
+    // waits for the modules to be loaded before the exception propagates.
+    auto librariesConfig = config["libraries"];
+    auto modulesLoaded = std::async(std::launch::async,
+        [&librariesConfig, report]() {
+            spdlog::trace("Initialize ModuleContext");
+            StartupReport::Span span{report.get(), "modules", "phase"};
+            // libraries are either an array of paths or an object
+            // mapping module names to paths (values are iterated alike)
+            bool paths = (librariesConfig.is_array() || librariesConfig.is_object())
+                && std::all_of(librariesConfig.begin(), librariesConfig.end(),
+                               [](const json& path) { return path.is_string(); });
+            if (paths) {
+                // loading them one by one to time each of them
+                for (auto& path : librariesConfig) {
+                    auto& p = path.get_ref<const std::string&>();
+                    report->measure(p, "module", [&p]() { ModuleManager::loadModule(p); });
+                }
+            } else {
+                ModuleManager::loadModulesFromJSON(librariesConfig.dump());
+            }
+            spdlog::trace("ModuleContext initialized");
+        });
+
     // Extract margo section from the config
     spdlog::trace("Initializing MargoManager");
     auto margoConfig = config["margo"].dump();
@@ -98,10 +205,24 @@ Server::Server(const std::string& address, const std::string& configString,
     // Initialize margo context
     auto margoMgr = MargoManager(address, margoConfig);
     spdlog::trace("MargoManager initialized");
-
-    // Sync addresses with other MPI members
+    report->phase("margo");
+
+    // Sync addresses with other MPI members, or expose this process'
+    // address for the others to fetch it on demand if the exchange is lazy
+    // (all the processes must agree on this setting)
+    bool lazyAddressExchange = false;
+    if (config.contains("bedrock") && config["bedrock"].is_object()
+    &&  config["bedrock"].contains("lazy_address_exchange")) {
+        auto lazyRef = config["bedrock"]["lazy_address_exchange"];
+        if (!lazyRef.is_boolean()) {
+            throw BEDROCK_DETAILED_EXCEPTION(
+                "Invalid type in Bedrock's \"lazy_address_exchange\" entry (expected boolean)");
+        }
+        lazyAddressExchange = lazyRef.get<bool>();
+    }
     std::string thisAddress = margoMgr.getThalliumEngine().self();
-    mpi.self->exchangeAddresses(thisAddress);
+    mpi.self->exchangeAddresses(thisAddress, lazyAddressExchange);
+    report->phase("address exchange");
 
     // Extract bedrock section from the config
     spdlog::trace("Reading Bedrock config");
@@ -111,6 +232,13 @@ Server::Server(const std::string& address, const std::string& configString,
     auto   bedrockConfig = config["bedrock"];
     double dependency_timeout
         = bedrockConfig.value("dependency_resolution_timeout", 30.0);
+    double config_cache_ttl
+        = bedrockConfig.value("config_cache_ttl", ServerImpl::defaultConfigTTL);
+    double collective_timeout
+        = bedrockConfig.value("collective_timeout", ServerImpl::defaultCollectiveTimeout);
+    if (collective_timeout <= 0)
+        throw BEDROCK_DETAILED_EXCEPTION(
+            "Invalid value in Bedrock's \"collective_timeout\" entry (expected positive number)");
     uint16_t bedrock_provider_id = bedrockConfig.value("provider_id", 0);
     std::shared_ptr<NamedDependency> bedrock_pool = margoMgr.getDefaultHandlerPool();
     if (bedrockConfig.contains("pool")) {
@@ -127,11 +255,43 @@ Server::Server(const std::string& address, const std::string& configString,
         }
     }
 
+    std::shared_ptr<NamedDependency> provider_startup_pool;
+    if (bedrockConfig.contains("provider_startup_pool")) {
+        auto startupPoolRef = bedrockConfig["provider_startup_pool"];
+        if (startupPoolRef.is_string()) {
+            provider_startup_pool = margoMgr.getPool(startupPoolRef.get<std::string>());
+        } else {
+            throw BEDROCK_DETAILED_EXCEPTION(
+                "Invalid type in Bedrock's \"provider_startup_pool\" entry");
+        }
+        if (!provider_startup_pool) {
+            throw BEDROCK_DETAILED_EXCEPTION(
+                "Invalid pool reference {} in Bedrock configuration",
+                startupPoolRef.dump());
+        }
+    }
+
+    std::string startup_trace;
+    if (bedrockConfig.contains("startup_trace")) {
+        auto startupTraceRef = bedrockConfig["startup_trace"];
+        if (!startupTraceRef.is_string()) {
+            throw BEDROCK_DETAILED_EXCEPTION(
+                "Invalid type in Bedrock's \"startup_trace\" entry");
+        }
+        startup_trace = startupTraceRef.get<std::string>();
+    }
+
     // Create self
     self = std::unique_ptr<ServerImpl>(
             new ServerImpl(margoMgr, bedrock_provider_id, bedrock_pool));
     self->m_mpi = mpi.self;
     self->m_jx9_manager = jx9Manager;
+    self->m_config_ttl  = std::chrono::duration<double>(config_cache_ttl);
+    self->m_collective_timeout = std::chrono::duration<double>(collective_timeout);
+    if (provider_startup_pool)
+        self->m_provider_startup_pool = provider_startup_pool->getName();
+    self->m_startup_trace = startup_trace;
+    self->m_lazy_address_exchange = lazyAddressExchange;
 
     try {
 
@@ -142,11 +302,12 @@ Server::Server(const std::string& address, const std::string& configString,
         self->m_provider_manager = providerManager;
         spdlog::trace("ProviderManager initialized");
 
-        // Initialize the module context
-        spdlog::trace("Initialize ModuleContext");
-        auto librariesConfig = config["libraries"].dump();
-        ModuleManager::loadModulesFromJSON(librariesConfig);
-        spdlog::trace("ModuleContext initialized");
+        report->phase("bedrock setup");
+
+        // Wait for the modules to be loaded
+        modulesLoaded.get();
+        providerManager.self->m_modules_generation += 1;
+        report->phase("waiting for modules");
 
         // Initializing dependency finder
         spdlog::trace("Initializing DependencyFinder");
@@ -159,18 +320,63 @@ Server::Server(const std::string& address, const std::string& configString,
         spdlog::trace("Initializing providers");
         auto& providerManagerConfig = config["providers"];
         providerManager.setDependencyFinder(dependencyFinder);
-        providerManager.addProviderListFromJSON(providerManagerConfig);
+        providerManager.self->m_startup_report = report;
+        providerManager.createProviderList(providerManagerConfig, provider_startup_pool, compiled);
+        providerManager.self->m_startup_report.reset();
         spdlog::trace("Providers initialized");
+        report->phase("providers");
 
     } catch(const Exception& ex) {
         finalize();
         throw;
     }
 
+    self->m_startup_report = report->toJSON();
+    spdlog::debug("Bedrock startup breakdown: {}", report->summary());
+    if (!startup_trace.empty())
+        writeStartupTrace(*report, startup_trace, mpi);
     spdlog::info("Bedrock daemon now running at {}",
                  static_cast<std::string>(margoMgr.getThalliumEngine().self()));
 }
 
+std::string Server::compileConfig(const std::string& configString,
+                                  ConfigType configType,
+                                  const Jx9ParamMap& jx9Params) {
+    if(configType == ConfigType::COMPILED)
+        throw Exception("Configuration is already compiled");
+
+    StartupReport report;
+    auto mpi        = MPIEnv{};
+    auto jx9Manager = Jx9Manager{mpi};
+    auto config     = resolveConfig(configString, configType, jx9Params, jx9Manager, report);
+
+    // Validate what can be validated without instantiating anything;
+    // an array holds one configuration per rank, selected at launch
+    auto validate = [](const json& candidate) {
+        if(!candidate.is_object())
+            throw Exception("Configuration should be an object");
+        if(candidate.contains("bedrock") && !candidate["bedrock"].is_object())
+            throw BEDROCK_DETAILED_EXCEPTION("Invalid entry type for \"bedrock\" (expected object)");
+        if(!candidate.contains("providers")) return;
+        auto& providers = candidate["providers"];
+        if(providers.is_null()) return;
+        if(!providers.is_array())
+            throw BEDROCK_DETAILED_EXCEPTION("Invalid entry type for \"providers\" (expected array)");
+        for(auto& description : providers)
+            validateProviderDescription(description);
+    };
+    if(config.is_array()) {
+        for(auto& candidate : config) validate(candidate);
+    } else {
+        validate(config);
+    }
+
+    auto document = json::object();
+    document[compiledConfigMarker] = compiledConfigVersion;
+    document["config"]             = std::move(config);
+    return encodeJSON(document, Encoding::CBOR);
+}
+
 Server::~Server() {}
 
 MargoManager Server::getMargoManager() const { return self->m_margo_manager; }
@@ -190,8 +396,12 @@ void Server::onFinalize() {
     spdlog::trace("Calling Server's finalize callback");
 }
 
+std::string Server::getStartupReport() const {
+    return self->m_startup_report.dump();
+}
+
 std::string Server::getCurrentConfig() const {
-    return self->makeConfig().dump();
+    return self->getConfigSnapshot()->serialized;
 }
 
 void Server::waitForFinalize() {
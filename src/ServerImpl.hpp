@@ -11,12 +11,18 @@
 #include "DependencyFinderImpl.hpp"
 #include "Jx9ManagerImpl.hpp"
 #include "MPIEnvImpl.hpp"
+#include "BulkResponse.hpp"
+#include "EndpointCache.hpp"
+#include "Encoding.hpp"
 #include "bedrock/Jx9Manager.hpp"
 #include "bedrock/RequestResult.hpp"
 #include "bedrock/ModuleManager.hpp"
 #include <thallium/serialization/stl/string.hpp>
+#include <thallium/serialization/stl/vector.hpp>
 #include <nlohmann/json.hpp>
 #include <spdlog/spdlog.h>
+#include <chrono>
+#include <deque>
 
 namespace bedrock {
 
@@ -24,6 +30,48 @@ using nlohmann::json;
 using namespace std::string_literals;
 namespace tl = thallium;
 
+/**
+ * @brief Configuration of the server at a given generation, along
+ * with its serialized form.
+ */
+struct ConfigSnapshot {
+    uint64_t    generation = 0;
+    json        config;
+    std::string serialized;
+
+    /**
+     * @brief Returns the configuration in the requested encoding,
+     * encoding it the first time it is requested.
+     */
+    const std::string& encoded(Encoding encoding) const {
+        if (encoding == Encoding::JSON) return serialized;
+        std::lock_guard<tl::mutex> lock(encoded_mtx);
+        auto it = encoded_content.find(encoding);
+        if (it == encoded_content.end())
+            it = encoded_content.emplace(encoding, encodeJSON(config, encoding)).first;
+        return it->second;
+    }
+
+    /**
+     * @brief Returns the patch (RFC 6902) from a previous snapshot to this
+     * one, computing it the first time it is requested.
+     */
+    const json& patchFrom(const ConfigSnapshot& previous) const {
+        std::lock_guard<tl::mutex> lock(patches_mtx);
+        auto it = patches.find(previous.generation);
+        if (it == patches.end())
+            it = patches.emplace(previous.generation, json::diff(previous.config, config)).first;
+        return it->second;
+    }
+
+  private:
+    mutable tl::mutex                                 encoded_mtx;
+    mutable std::unordered_map<Encoding, std::string> encoded_content;
+    // patches from previous generations, at most one per snapshot in the history
+    mutable tl::mutex                                 patches_mtx;
+    mutable std::unordered_map<uint64_t, json>        patches;
+};
+
 class ServerImpl : public tl::provider<ServerImpl> {
 
   public:
@@ -35,8 +83,63 @@ class ServerImpl : public tl::provider<ServerImpl> {
     std::shared_ptr<NamedDependency>      m_pool;
     tl::pool                              m_tl_pool;
 
+    // cached configuration, rebuilt when one of the managers' generations
+    // changed since it was built, or when it is older than m_config_ttl
+    // (if positive) in case a provider changed its own configuration
+    // without invalidating it (see ProviderManager::invalidateConfig)
+    mutable tl::mutex                             m_config_mtx;
+    mutable std::shared_ptr<const ConfigSnapshot> m_config_snapshot;
+    mutable std::chrono::steady_clock::time_point m_config_checked_at;
+    std::chrono::duration<double>                 m_config_ttl{defaultConfigTTL};
+    mutable uint64_t                              m_config_generation    = initialGeneration();
+    mutable uint64_t                              m_margo_generation     = 0;
+    mutable uint64_t                              m_providers_generation = 0;
+    mutable uint64_t                              m_modules_generation   = 0;
+
+    static constexpr double defaultConfigTTL = 600.0;
+    // previous snapshots, oldest first, to compute patches from
+    mutable std::deque<std::shared_ptr<const ConfigSnapshot>> m_config_history;
+    size_t                                                    m_config_history_size = 16;
+
+    // optional entries of the bedrock section, reported as configured
+    std::string m_provider_startup_pool;
+    std::string m_startup_trace;
+    bool        m_lazy_address_exchange = false;
+
+    // timings of the server's startup, set once the server is running
+    json m_startup_report = json::object();
+
     tl::remote_procedure m_get_config_rpc;
+    tl::remote_procedure m_get_config_encoded_rpc;
+    tl::remote_procedure m_get_config_since_rpc;
     tl::remote_procedure m_query_config_rpc;
+    tl::remote_procedure m_query_config_bulk_rpc;
+    tl::remote_procedure m_release_response_rpc;
+    tl::remote_procedure m_collective_rpc;
+
+    // time a process waits for a child of a collective operation, per level
+    // of the child's subtree (a child must give up on its own children first)
+    std::chrono::duration<double> m_collective_timeout{defaultCollectiveTimeout};
+
+    static constexpr double defaultCollectiveTimeout = 30.0;
+
+    // responses larger than this are exposed for the client to pull them
+    size_t m_bulk_threshold = BulkResponse::threshold;
+
+    /**
+     * @brief Content of a response exposed until the client releases it,
+     * or until it expires if the client never does (e.g. it died).
+     */
+    struct ExposedResponse {
+        std::shared_ptr<const std::string>    content;
+        tl::bulk                              bulk;
+        std::chrono::steady_clock::time_point expires;
+    };
+
+    tl::mutex                                     m_exposed_mtx;
+    std::unordered_map<uint64_t, ExposedResponse> m_exposed_responses;
+    uint64_t                                      m_last_exposed_id = 0;
+    std::chrono::duration<double>                 m_exposed_ttl{60.0};
 
     tl::remote_procedure m_add_pool_rpc;
     tl::remote_procedure m_add_xstream_rpc;
@@ -51,8 +154,19 @@ class ServerImpl : public tl::provider<ServerImpl> {
       m_tl_pool(pool->getHandle<tl::pool>()),
       m_get_config_rpc(
           define("bedrock_get_config", &ServerImpl::getConfigRPC, m_tl_pool)),
+      m_get_config_encoded_rpc(
+          define("bedrock_get_config_encoded", &ServerImpl::getConfigEncodedRPC, m_tl_pool)),
+      m_get_config_since_rpc(
+          define("bedrock_get_config_since", &ServerImpl::getConfigSinceRPC, m_tl_pool)),
       m_query_config_rpc(
           define("bedrock_query_config", &ServerImpl::queryConfigRPC, m_tl_pool)),
+      m_query_config_bulk_rpc(
+          define("bedrock_query_config_bulk", &ServerImpl::queryConfigBulkRPC, m_tl_pool)),
+      m_release_response_rpc(
+          define("bedrock_release_response", &ServerImpl::releaseResponseRPC, m_tl_pool)
+          .disable_response()),
+      m_collective_rpc(
+          define("bedrock_collective", &ServerImpl::collectiveRPC, m_tl_pool)),
       m_add_pool_rpc(
           define("bedrock_add_pool", &ServerImpl::addPoolRPC, m_tl_pool)),
       m_add_xstream_rpc(
@@ -65,35 +179,189 @@ class ServerImpl : public tl::provider<ServerImpl> {
 
     ~ServerImpl() {
         m_get_config_rpc.deregister();
+        m_get_config_encoded_rpc.deregister();
+        m_get_config_since_rpc.deregister();
         m_query_config_rpc.deregister();
+        m_query_config_bulk_rpc.deregister();
+        m_release_response_rpc.deregister();
+        m_collective_rpc.deregister();
         m_add_pool_rpc.deregister();
         m_add_xstream_rpc.deregister();
         m_remove_pool_rpc.deregister();
         m_remove_xstream_rpc.deregister();
     }
 
-    json makeConfig() const {
-        auto config         = json::object();
+    /**
+     * @brief Returns the current configuration, rebuilding it only if
+     * pools, xstreams, providers or libraries changed since the last call,
+     * or if it was invalidated (ProviderManager::invalidateConfig).
+     * Changes a provider makes to its own configuration without
+     * invalidating it are only detected once the snapshot is older than
+     * m_config_ttl (if positive), by rebuilding it and comparing it with
+     * the cached one.
+     */
+    std::shared_ptr<const ConfigSnapshot> getConfigSnapshot() const {
+        std::lock_guard<tl::mutex> lock(m_config_mtx);
+        // generations are read before building the configuration, so that
+        // a change happening while it is built leads to a rebuild next time
+        uint64_t margo_generation     = m_margo_manager->m_generation;
+        uint64_t providers_generation = m_provider_manager->m_generation;
+        uint64_t modules_generation   = m_provider_manager->m_modules_generation;
+        auto     now                  = std::chrono::steady_clock::now();
+        bool     expired              = m_config_ttl.count() > 0
+                                     && now - m_config_checked_at > m_config_ttl;
+        if (m_config_snapshot
+        &&  margo_generation     == m_margo_generation
+        &&  providers_generation == m_providers_generation
+        &&  modules_generation   == m_modules_generation
+        &&  !expired)
+            return m_config_snapshot;
+        auto snapshot       = std::make_shared<ConfigSnapshot>();
+        auto& config        = snapshot->config;
+        config              = json::object();
         config["margo"]     = m_margo_manager->makeConfig();
         config["providers"] = m_provider_manager->makeConfig();
         config["libraries"] = json::parse(ModuleManager::getCurrentConfig());
         config["bedrock"]   = json::object();
         config["bedrock"]["pool"] = m_pool->getName();
         config["bedrock"]["provider_id"] = get_provider_id();
-        return config;
+        if (!m_provider_startup_pool.empty())
+            config["bedrock"]["provider_startup_pool"] = m_provider_startup_pool;
+        if (m_lazy_address_exchange)
+            config["bedrock"]["lazy_address_exchange"] = true;
+        if (!m_startup_trace.empty())
+            config["bedrock"]["startup_trace"] = m_startup_trace;
+        if (m_collective_timeout.count() != defaultCollectiveTimeout)
+            config["bedrock"]["collective_timeout"] = m_collective_timeout.count();
+        if (m_config_ttl.count() != defaultConfigTTL)
+            config["bedrock"]["config_cache_ttl"] = m_config_ttl.count();
+        m_config_checked_at       = now;
+        m_margo_generation        = margo_generation;
+        m_providers_generation    = providers_generation;
+        m_modules_generation      = modules_generation;
+        // nothing actually changed, keep the current generation
+        if (m_config_snapshot && config == m_config_snapshot->config)
+            return m_config_snapshot;
+        snapshot->serialized = config.dump();
+        snapshot->generation = ++m_config_generation;
+        if (m_config_snapshot) {
+            m_config_history.push_back(std::move(m_config_snapshot));
+            if (m_config_history.size() > m_config_history_size)
+                m_config_history.pop_front();
+        }
+        m_config_snapshot      = std::move(snapshot);
+        return m_config_snapshot;
+    }
+
+    /**
+     * @brief Generations start from the time the server was created, in
+     * microseconds, so that a generation seen by a client of a previous
+     * instance of the server cannot be mistaken for a current one.
+     */
+    static uint64_t initialGeneration() {
+        using namespace std::chrono;
+        return duration_cast<microseconds>(
+            system_clock::now().time_since_epoch()).count();
+    }
+
+    /**
+     * @brief Returns a JSON document describing the changes to the
+     * configuration since the given generation: {"generation":<current>}
+     * with either "unchanged":true, a "patch" (RFC 6902) to apply to the
+     * configuration at the given generation, or the full "config" if that
+     * generation is unknown (e.g. 0, or too old).
+     */
+    json makeConfigChanges(uint64_t generation) const {
+        auto current = getConfigSnapshot();
+        auto changes = json::object();
+        changes["generation"] = current->generation;
+        if (generation == current->generation) {
+            changes["unchanged"] = true;
+            return changes;
+        }
+        std::shared_ptr<const ConfigSnapshot> previous;
+        {
+            std::lock_guard<tl::mutex> lock(m_config_mtx);
+            for (auto& snapshot : m_config_history) {
+                if (snapshot->generation == generation) {
+                    previous = snapshot;
+                    break;
+                }
+            }
+        }
+        if (previous)
+            changes["patch"] = current->patchFrom(*previous);
+        else
+            changes["config"] = current->config;
+        return changes;
     }
 
     void getConfigRPC(const tl::request& req) {
         RequestResult<std::string> result;
-        result.value() = makeConfig().dump();
+        result.value() = getConfigSnapshot()->serialized;
+        req.respond(result);
+    }
+
+    /**
+     * @brief Fills the response with the content, inline if it is at most
+     * m_bulk_threshold bytes, otherwise exposing it until the client pulls
+     * it and releases it (see releaseResponseRPC).
+     */
+    void makeBulkResponse(std::shared_ptr<const std::string> content, BulkResponse& response) {
+        response.size = content->size();
+        if (content->size() <= m_bulk_threshold) {
+            response.inlined = *content;
+            return;
+        }
+        auto bulk = get_engine().expose(
+            {{const_cast<char*>(content->data()), content->size()}},
+            tl::bulk_mode::read_only);
+        auto now = std::chrono::steady_clock::now();
+        std::lock_guard<tl::mutex> lock(m_exposed_mtx);
+        for (auto it = m_exposed_responses.begin(); it != m_exposed_responses.end();) {
+            if (it->second.expires < now) it = m_exposed_responses.erase(it);
+            else ++it;
+        }
+        response.in_bulk = true;
+        response.bulk    = bulk;
+        response.id      = ++m_last_exposed_id;
+        auto expires     = now + std::chrono::duration_cast<std::chrono::steady_clock::duration>(m_exposed_ttl);
+        m_exposed_responses.emplace(response.id,
+            ExposedResponse{std::move(content), std::move(bulk), expires});
+    }
+
+    void releaseResponseRPC(const tl::request&, uint64_t id) {
+        std::lock_guard<tl::mutex> lock(m_exposed_mtx);
+        m_exposed_responses.erase(id);
+    }
+
+    void getConfigEncodedRPC(const tl::request& req, uint8_t requested_encoding) {
+        RequestResult<BulkResponse> result;
+        try {
+            auto encoding = encodingFromValue(requested_encoding);
+            auto snapshot = getConfigSnapshot();
+            // the content shares the ownership of the snapshot it belongs to
+            auto content  = std::shared_ptr<const std::string>(snapshot, &snapshot->encoded(encoding));
+            makeBulkResponse(std::move(content), result.value());
+            result.value().encoding = static_cast<uint8_t>(encoding);
+        } catch (const tl::exception& ex) {
+            result.error()   = ex.what();
+            result.success() = false;
+        }
+        req.respond(result);
+    }
+
+    void getConfigSinceRPC(const tl::request& req, uint64_t generation) {
+        RequestResult<std::string> result;
+        result.value() = makeConfigChanges(generation).dump();
         req.respond(result);
     }
 
     void queryConfigRPC(const tl::request& req, const std::string& script) {
         RequestResult<std::string> result;
         try {
-            std::unordered_map<std::string, std::string> args;
-            args["__config__"] = makeConfig().dump();
+            auto snapshot = getConfigSnapshot();
+            std::unordered_map<std::string, const json*> args{{"__config__", &snapshot->config}};
             result.value()
                 = Jx9Manager(m_jx9_manager).executeQuery(script, args);
             result.success() = true;
@@ -104,6 +372,139 @@ class ServerImpl : public tl::provider<ServerImpl> {
         req.respond(result);
     }
 
+    void queryConfigBulkRPC(const tl::request& req, const std::string& script) {
+        RequestResult<BulkResponse> result;
+        try {
+            auto snapshot = getConfigSnapshot();
+            std::unordered_map<std::string, const json*> args{{"__config__", &snapshot->config}};
+            auto content = Jx9Manager(m_jx9_manager).executeQuery(script, args);
+            makeBulkResponse(std::make_shared<const std::string>(std::move(content)),
+                             result.value());
+        } catch (const Exception& ex) {
+            result.error()   = ex.what();
+            result.success() = false;
+        } catch (const tl::exception& ex) {
+            result.error()   = ex.what();
+            result.success() = false;
+        }
+        req.respond(result);
+    }
+
+    /**
+     * @brief Runs a getConfig (if the script is empty) or a queryConfig
+     * on the processes at the given addresses, the first of which is this
+     * process. The other addresses are split into up to fanout contiguous
+     * ranges and the first process of each range is sent the rest of its
+     * range, so that the operation propagates along a k-ary tree and each
+     * process only combines its own result with those of its children.
+     *
+     * Without reduce script, the response is a JSON object mapping each
+     * address to its result. Otherwise the results are folded one at a
+     * time, as the children respond, by running the reduce script with
+     * $__values__ set to an array of two values (the partial reduction
+     * so far and the next result), and the response is the reduced value.
+     *
+     * The handler waits for the children's responses (yielding, so it does
+     * not block its execution stream) for up to m_collective_timeout per
+     * level of their subtree, and only then responds.
+     */
+    void collectiveRPC(const tl::request& req, const std::string& script,
+                       const std::string& reduce_script,
+                       const std::vector<std::string>& addresses, uint32_t fanout) {
+        RequestResult<std::string> result;
+        tl::auto_respond<decltype(result)> auto_respond_with{req, result};
+        if (addresses.empty() || fanout == 0) {
+            result.success() = false;
+            result.error()   = "Invalid collective operation (no address or null fanout)";
+            return;
+        }
+
+        // forward the operation to the children before running it locally
+        const size_t m            = addresses.size() - 1;
+        const size_t num_children = std::min<size_t>(fanout, m);
+        std::vector<std::pair<std::string, tl::async_response>> children;
+        std::string error;
+        children.reserve(num_children);
+        auto endpoints = EndpointCache::get(get_engine());
+        for (size_t c = 0; c < num_children; ++c) {
+            auto begin = addresses.begin() + 1 + c * m / num_children;
+            auto end   = addresses.begin() + 1 + (c + 1) * m / num_children;
+            size_t levels = 0;
+            for (size_t s = end - begin; s > 1; s = (s - 1 + fanout - 1) / fanout) ++levels;
+            try {
+                tl::provider_handle ph{endpoints->lookup(*begin), get_provider_id()};
+                children.emplace_back(*begin, m_collective_rpc.on(ph).timed_async(
+                    m_collective_timeout * (levels + 1),
+                    script, reduce_script, std::vector<std::string>(begin, end), fanout));
+            } catch (const tl::exception& ex) {
+                endpoints->invalidate(*begin);
+                if (error.empty()) error = fmt::format("{}: {}", *begin, ex.what());
+            }
+        }
+
+        auto query = [this](const std::string& code, const json& value,
+                            const char* name) {
+            std::unordered_map<std::string, const json*> args{{name, &value}};
+            auto content = Jx9Manager(m_jx9_manager).executeQuery(code, args);
+            return content.empty() ? json() : json::parse(content);
+        };
+
+        // without reduction, results are spliced as strings
+        // rather than parsed and merged
+        std::string merged;
+        json        reduced;
+        try {
+            auto snapshot = getConfigSnapshot();
+            if (!reduce_script.empty()) {
+                reduced = query(script, snapshot->config, "__config__");
+            } else if (script.empty()) {
+                merged = snapshot->serialized;
+            } else {
+                merged = query(script, snapshot->config, "__config__").dump();
+            }
+        } catch (const std::exception& ex) {
+            if (error.empty()) error = fmt::format("{}: {}", addresses[0], ex.what());
+        }
+        if (reduce_script.empty())
+            merged = "{" + json(addresses[0]).dump() + ":" + merged;
+
+        for (auto& [address, response] : children) {
+            try {
+                RequestResult<std::string> child_result = response.wait();
+                if (!child_result.success()) {
+                    // the child's error already names the failing process
+                    if (error.empty()) error = child_result.error();
+                    continue;
+                }
+                if (!error.empty()) continue;
+                auto& content = child_result.value();
+                if (!reduce_script.empty()) {
+                    auto values = json::array({std::move(reduced), json::parse(content)});
+                    reduced = query(reduce_script, values, "__values__");
+                } else if (content.size() > 2) {
+                    merged += ",";
+                    merged.append(content, 1, content.size() - 2);
+                }
+            } catch (const tl::timeout&) {
+                if (error.empty()) error = fmt::format("{}: timed out", address);
+            } catch (const tl::exception& ex) {
+                endpoints->invalidate(address);
+                if (error.empty()) error = fmt::format("{}: {}", address, ex.what());
+            } catch (const std::exception& ex) {
+                if (error.empty()) error = fmt::format("{}: {}", addresses[0], ex.what());
+            }
+        }
+
+        if (!error.empty()) {
+            result.success() = false;
+            result.error()   = std::move(error);
+        } else if (!reduce_script.empty()) {
+            result.value() = reduced.dump();
+        } else {
+            result.value() = std::move(merged) + "}";
+        }
+    }
+
     void addPoolRPC(const tl::request& req, const std::string& config) {
         RequestResult<bool> result;
         result.success() = true;
@@ -12,6 +12,7 @@
 #include "ClientImpl.hpp"
 #include "ServiceGroupHandleImpl.hpp"
 
+#include <algorithm>
 #include <cstring>
 
 namespace bedrock {
@@ -64,23 +65,61 @@ void ServiceGroupHandle::refresh() const {
     self->m_shs = std::move(shs);
 }
 
+void ServiceGroupHandle::setTreeFanout(uint32_t k) const {
+    if (!self) throw BEDROCK_DETAILED_EXCEPTION("Invalid bedrock::ServiceGroupHandle object");
+    self->m_tree_fanout = k;
+}
+
+void ServiceGroupHandle::addProviders(
+        const std::vector<nlohmann::json>&                  descriptions,
+        std::vector<std::vector<RequestResult<uint16_t>>>* results,
+        AsyncRequest*                                       req) const {
+    if (not self) throw BEDROCK_DETAILED_EXCEPTION("Invalid bedrock::ServiceGroupHandle object");
+    if (req && req->active()) throw BEDROCK_DETAILED_EXCEPTION("AsyncRequest object passed is already in use");
+    const auto n = self->m_shs.size();
+    if (descriptions.size() != n)
+        throw BEDROCK_DETAILED_EXCEPTION(
+            "Invalid number of provider lists (expected {}, got {})", n, descriptions.size());
+    std::vector<std::shared_ptr<AsyncRequestImpl>> reqs(n);
+    std::vector<std::vector<RequestResult<uint16_t>>> member_results(n);
+    // all the RPCs are issued before any of them is waited on
+    for(unsigned i=0; i < n; i++) {
+        AsyncRequest r;
+        ServiceHandle(self->m_shs[i]).addProviders(descriptions[i], &member_results[i], &r);
+        reqs[i] = std::move(r.self);
+    }
+    auto req_impl = std::make_shared<MultiAsyncRequest>(std::move(reqs));
+    req_impl->m_wait_callback = [member_results=std::move(member_results), results](MultiAsyncRequest&) mutable {
+        if(results) *results = std::move(member_results);
+    };
+    if(!req) req_impl->wait();
+    else req->self = std::move(req_impl);
+}
+
 void ServiceGroupHandle::getConfig(std::string* result, AsyncRequest* req) const {
     if (not self) throw BEDROCK_DETAILED_EXCEPTION("Invalid bedrock::ServiceGroupHandle object");
     if (req && req->active()) throw BEDROCK_DETAILED_EXCEPTION("AsyncRequest object passed is already in use");
+    if (self->m_tree_fanout && self->m_shs.size() > 1) {
+        auto req_impl = self->sendCollective("", "", self->m_tree_fanout, result, req != nullptr);
+        if (req) req->self = std::move(req_impl);
+        return;
+    }
     const auto n = self->m_shs.size();
     std::vector<std::shared_ptr<AsyncRequestImpl>> reqs(n);
     std::vector<std::string> results(n);
+    std::vector<std::string> addresses(n);
+    // all the RPCs are issued before any of them is waited on
     for(unsigned i=0; i < n; i++) {
         AsyncRequest r;
+        addresses[i] = static_cast<std::string>(self->m_shs[i]->m_ph);
         ServiceHandle(self->m_shs[i]).getConfig(&results[i], &r);
         reqs[i] = std::move(r.self);
     }
     auto req_impl = std::make_shared<MultiAsyncRequest>(std::move(reqs));
-    req_impl->m_wait_callback = [n, self=this->self, results=std::move(results), result](MultiAsyncRequest&) {
+    req_impl->m_wait_callback = [n, addresses=std::move(addresses), results=std::move(results), result](MultiAsyncRequest&) {
         auto obj = json::object();
         for(unsigned i = 0; i < n; i++) {
-            auto addr = static_cast<std::string>(self->m_shs[i]->m_ph);
-            obj[addr] = results[i].empty() ? json() : json::parse(results[i]);
+            obj[addresses[i]] = results[i].empty() ? json() : json::parse(results[i]);
         }
         if(result) *result = obj.dump();
     };
@@ -88,24 +127,61 @@ void ServiceGroupHandle::getConfig(std::string* result, AsyncRequest* req) const
     else req->self = std::move(req_impl);
 }
 
+void ServiceGroupHandle::getConfigSince(
+        const std::unordered_map<std::string, uint64_t>& generations,
+        std::string* changes, AsyncRequest* req) const {
+    if (not self) throw BEDROCK_DETAILED_EXCEPTION("Invalid bedrock::ServiceGroupHandle object");
+    if (req && req->active()) throw BEDROCK_DETAILED_EXCEPTION("AsyncRequest object passed is already in use");
+    const auto n = self->m_shs.size();
+    std::vector<std::shared_ptr<AsyncRequestImpl>> reqs(n);
+    std::vector<std::string> results(n);
+    std::vector<std::string> addresses(n);
+    // all the RPCs are issued before any of them is waited on
+    for(unsigned i=0; i < n; i++) {
+        AsyncRequest r;
+        addresses[i] = static_cast<std::string>(self->m_shs[i]->m_ph);
+        auto it = generations.find(addresses[i]);
+        uint64_t generation = it == generations.end() ? 0 : it->second;
+        ServiceHandle(self->m_shs[i]).getConfigSince(generation, &results[i], &r);
+        reqs[i] = std::move(r.self);
+    }
+    auto req_impl = std::make_shared<MultiAsyncRequest>(std::move(reqs));
+    req_impl->m_wait_callback = [n, addresses=std::move(addresses), results=std::move(results), changes](MultiAsyncRequest&) {
+        auto obj = json::object();
+        for(unsigned i = 0; i < n; i++) {
+            obj[addresses[i]] = results[i].empty() ? json() : json::parse(results[i]);
+        }
+        if(changes) *changes = obj.dump();
+    };
+    if(!req) req_impl->wait();
+    else req->self = std::move(req_impl);
+}
+
 void ServiceGroupHandle::queryConfig(const std::string& script, std::string* result,
                                      AsyncRequest* req) const {
     if (not self) throw BEDROCK_DETAILED_EXCEPTION("Invalid bedrock::ServiceGroupHandle object");
     if (req && req->active()) throw BEDROCK_DETAILED_EXCEPTION("AsyncRequest object passed is already in use");
+    if (self->m_tree_fanout && self->m_shs.size() > 1) {
+        auto req_impl = self->sendCollective(script, "", self->m_tree_fanout, result, req != nullptr);
+        if (req) req->self = std::move(req_impl);
+        return;
+    }
     const auto n = self->m_shs.size();
     std::vector<std::shared_ptr<AsyncRequestImpl>> reqs(n);
     std::vector<std::string> results(n);
+    std::vector<std::string> addresses(n);
+    // all the RPCs are issued before any of them is waited on
     for(unsigned i=0; i < n; i++) {
         AsyncRequest r;
+        addresses[i] = static_cast<std::string>(self->m_shs[i]->m_ph);
         ServiceHandle(self->m_shs[i]).queryConfig(script, &results[i], &r);
         reqs[i] = std::move(r.self);
     }
     auto req_impl = std::make_shared<MultiAsyncRequest>(std::move(reqs));
-    req_impl->m_wait_callback = [n, self=this->self, results=std::move(results), result](MultiAsyncRequest&) {
+    req_impl->m_wait_callback = [n, addresses=std::move(addresses), results=std::move(results), result](MultiAsyncRequest&) {
         auto obj = json::object();
         for(unsigned i = 0; i < n; i++) {
-            auto addr = static_cast<std::string>(self->m_shs[i]->m_ph);
-            obj[addr] = results[i].empty() ? json() : json::parse(results[i]);
+            obj[addresses[i]] = results[i].empty() ? json() : json::parse(results[i]);
         }
         if(result) *result = obj.dump();
     };
@@ -113,4 +189,18 @@ void ServiceGroupHandle::queryConfig(const std::string& script, std::string* res
     else req->self = std::move(req_impl);
 }
 
+void ServiceGroupHandle::mapReduceConfig(const std::string& map_script,
+                                         const std::string& reduce_script,
+                                         std::string* result, AsyncRequest* req) const {
+    if (not self) throw BEDROCK_DETAILED_EXCEPTION("Invalid bedrock::ServiceGroupHandle object");
+    if (req && req->active()) throw BEDROCK_DETAILED_EXCEPTION("AsyncRequest object passed is already in use");
+    if (reduce_script.empty()) throw BEDROCK_DETAILED_EXCEPTION("Empty reduce script");
+    const auto n = self->m_shs.size();
+    if (n == 0) throw BEDROCK_DETAILED_EXCEPTION("Cannot reduce over an empty group");
+    // without tree, the first member gathers the results of all the others
+    auto fanout   = self->m_tree_fanout ? self->m_tree_fanout : static_cast<uint32_t>(std::max<size_t>(n - 1, 1));
+    auto req_impl = self->sendCollective(map_script, reduce_script, fanout, result, req != nullptr);
+    if (req) req->self = std::move(req_impl);
+}
+
 } // namespace bedrock
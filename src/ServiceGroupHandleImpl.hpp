@@ -27,6 +27,7 @@ class ServiceGroupHandleImpl {
     std::shared_ptr<ClientImpl>                     m_client;
     uint16_t                                        m_provider_id;
     std::vector<std::shared_ptr<ServiceHandleImpl>> m_shs;
+    uint32_t                                        m_tree_fanout = 0; // 0 for one RPC per member
 
 #ifdef ENABLE_FLOCK
     flock_client_t                                  m_flock_client = FLOCK_CLIENT_NULL;
@@ -46,6 +47,27 @@ class ServiceGroupHandleImpl {
 #endif
     }
 
+    /**
+     * @brief Sends a collective getConfig (empty script), queryConfig or
+     * mapReduceConfig (non-empty reduce script) operation to the first
+     * member, which propagates it to the others along a tree of the given
+     * fanout and replies with the combined results.
+     */
+    std::shared_ptr<AsyncRequestImpl> sendCollective(const std::string& script,
+                                                     const std::string& reduce_script,
+                                                     uint32_t fanout,
+                                                     std::string* result,
+                                                     bool async) const {
+        std::vector<std::string> addresses;
+        addresses.reserve(m_shs.size());
+        for (auto& sh : m_shs) addresses.push_back(static_cast<std::string>(sh->m_ph));
+        auto on_success = [result](std::string& response) {
+            if (result) *result = std::move(response);
+        };
+        return m_shs[0]->send<std::string>(m_client->m_collective, async, on_success,
+                                           script, reduce_script, addresses, fanout);
+    }
+
     std::vector<std::string> queryAddresses(bool refresh) const {
         std::vector<std::string> addresses;
 #if ENABLE_FLOCK
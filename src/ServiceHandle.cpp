@@ -10,6 +10,7 @@
 #include "AsyncRequestImpl.hpp"
 #include "ClientImpl.hpp"
 #include "ServiceHandleImpl.hpp"
+#include "Encoding.hpp"
 
 #include <thallium/serialization/stl/string.hpp>
 #include <thallium/serialization/stl/pair.hpp>
@@ -47,34 +48,39 @@ tl::provider_handle ServiceHandle::providerHandle() const {
     return self->m_ph;
 }
 
-#define SEND_RPC_WITH_BOOL_RESULT(...) do {\
-    if (req == nullptr) { \
-        RequestResult<bool> response = rpc.on(ph)(__VA_ARGS__); \
-        if (!response.success()) { throw BEDROCK_DETAILED_EXCEPTION(response.error()); } \
-    } else { \
-        if (req->active()) { \
-            throw BEDROCK_DETAILED_EXCEPTION("AsyncRequest object passed is already in use"); \
-        }; \
-        auto async_response = rpc.on(ph).async(__VA_ARGS__); \
-        auto async_request_impl \
-            = std::make_shared<AsyncThalliumResponse>(std::move(async_response)); \
-        async_request_impl->m_wait_callback \
-            = [](AsyncThalliumResponse& async_request_impl) { \
-                  RequestResult<bool> response \
-                      = async_request_impl.m_async_response.wait(); \
-                  if (!response.success()) { \
-                      throw BEDROCK_DETAILED_EXCEPTION(response.error()); \
-                  } \
-              }; \
-        *req = AsyncRequest(std::move(async_request_impl)); \
+/**
+ * Sends the RPC through ServiceHandleImpl::send, returning a RequestResult<T>
+ * whose value is passed to on_success (the first variadic argument, followed
+ * by the RPC's arguments), and stores the pending request in req if the call
+ * is asynchronous.
+ */
+#define SEND_RPC(T, ...) do {\
+    if (req && req->active()) { \
+        throw BEDROCK_DETAILED_EXCEPTION("AsyncRequest object passed is already in use"); \
     } \
+    auto async_request_impl = self->send<T>(rpc, req != nullptr, __VA_ARGS__); \
+    if (req) req->self = std::move(async_request_impl); \
+} while(0)
+
+#define SEND_RPC_WITH_BOOL_RESULT(...) SEND_RPC(bool, [](bool) {}, __VA_ARGS__)
+
+/**
+ * Same as SEND_RPC, but calls fallback instead of failing if the RPC itself
+ * fails, e.g. because the server runs an older version of Bedrock.
+ */
+#define SEND_RPC_WITH_FALLBACK(T, on_success, fallback, ...) do {\
+    if (req && req->active()) { \
+        throw BEDROCK_DETAILED_EXCEPTION("AsyncRequest object passed is already in use"); \
+    } \
+    auto async_request_impl = self->sendWithFallback<T>( \
+        rpc, req != nullptr, on_success, fallback, __VA_ARGS__); \
+    if (req) req->self = std::move(async_request_impl); \
 } while(0)
 
 void ServiceHandle::loadModule(const std::string& path,
                                AsyncRequest* req) const {
     if (not self) throw BEDROCK_DETAILED_EXCEPTION("Invalid bedrock::ServiceHandle object");
     auto& rpc = self->m_client->m_load_module;
-    auto& ph  = self->m_ph;
     SEND_RPC_WITH_BOOL_RESULT(path);
 }
 
@@ -83,29 +89,25 @@ void ServiceHandle::addProvider(const std::string& description,
                                 AsyncRequest*      req) const {
     if (not self) throw BEDROCK_DETAILED_EXCEPTION("Invalid bedrock::ServiceHandle object");
     auto& rpc = self->m_client->m_start_provider;
-    auto& ph  = self->m_ph;
-    if (req == nullptr) {
-        RequestResult<uint16_t> response = rpc.on(ph)(description);
-        if (!response.success()) { throw BEDROCK_DETAILED_EXCEPTION(response.error()); }
-        if(provider_id_out) *provider_id_out = response.value();
-    } else {
-        if (req->active()) {
-            throw BEDROCK_DETAILED_EXCEPTION("AsyncRequest object passed is already in use");
-        };
-        auto async_response = rpc.on(ph).async(description);
-        auto async_request_impl
-            = std::make_shared<AsyncThalliumResponse>(std::move(async_response));
-        async_request_impl->m_wait_callback
-            = [provider_id_out](AsyncThalliumResponse& async_request_impl) {
-                  RequestResult<uint16_t> response
-                      = async_request_impl.m_async_response.wait();
-                  if (!response.success()) {
-                      throw BEDROCK_DETAILED_EXCEPTION(response.error());
-                  }
-                  if(provider_id_out) *provider_id_out = response.value();
-              };
-        *req = AsyncRequest(std::move(async_request_impl));
-    }
+    auto on_success = [provider_id_out](uint16_t provider_id) {
+        if (provider_id_out) *provider_id_out = provider_id;
+    };
+    SEND_RPC(uint16_t, on_success, description);
+}
+
+void ServiceHandle::addProviders(const nlohmann::json&                 descriptions,
+                                 std::vector<RequestResult<uint16_t>>* results,
+                                 AsyncRequest*                         req) const {
+    if (not self) throw BEDROCK_DETAILED_EXCEPTION("Invalid bedrock::ServiceHandle object");
+    if (!descriptions.is_array())
+        throw BEDROCK_DETAILED_EXCEPTION("Provider descriptions should be a JSON array");
+    auto& rpc      = self->m_client->m_start_providers;
+    auto  encoding = Encoding::CBOR;
+    auto on_success = [results](std::vector<RequestResult<uint16_t>>& response) {
+        if (results) *results = std::move(response);
+    };
+    SEND_RPC(std::vector<RequestResult<uint16_t>>, on_success,
+             static_cast<uint8_t>(encoding), encodeJSON(descriptions, encoding));
 }
 
 void ServiceHandle::changeProviderPool(const std::string& provider_name,
@@ -113,7 +115,6 @@ void ServiceHandle::changeProviderPool(const std::string& provider_name,
                                        AsyncRequest*        req) const {
     if (not self) throw BEDROCK_DETAILED_EXCEPTION("Invalid bedrock::ServiceHandle object");
     auto& rpc = self->m_client->m_change_provider_pool;
-    auto& ph  = self->m_ph;
     SEND_RPC_WITH_BOOL_RESULT(provider_name, pool);
 }
 
@@ -126,7 +127,6 @@ void ServiceHandle::migrateProvider(
               AsyncRequest*      req) const {
     if (not self) throw BEDROCK_DETAILED_EXCEPTION("Invalid bedrock::ServiceHandle object");
     auto& rpc = self->m_client->m_migrate_provider;
-    auto& ph  = self->m_ph;
     SEND_RPC_WITH_BOOL_RESULT(provider, dest_addr, dest_provider_id, migration_config, remove_source);
 }
 
@@ -138,7 +138,6 @@ void ServiceHandle::snapshotProvider(
               AsyncRequest*      req) const {
     if (not self) throw BEDROCK_DETAILED_EXCEPTION("Invalid bedrock::ServiceHandle object");
     auto& rpc = self->m_client->m_snapshot_provider;
-    auto& ph  = self->m_ph;
     SEND_RPC_WITH_BOOL_RESULT(provider, dest_path, snapshot_config, remove_source);
 }
 
@@ -149,7 +148,6 @@ void ServiceHandle::restoreProvider(
         AsyncRequest*      req) const {
     if (not self) throw BEDROCK_DETAILED_EXCEPTION("Invalid bedrock::ServiceHandle object");
     auto& rpc = self->m_client->m_restore_provider;
-    auto& ph  = self->m_ph;
     SEND_RPC_WITH_BOOL_RESULT(provider, src_path, restore_config);
 }
 
@@ -158,7 +156,6 @@ void ServiceHandle::addClient(const std::string& description,
                               AsyncRequest*        req) const {
     if (not self) throw BEDROCK_DETAILED_EXCEPTION("Invalid bedrock::ServiceHandle object");
     auto& rpc = self->m_client->m_add_client;
-    auto& ph  = self->m_ph;
     SEND_RPC_WITH_BOOL_RESULT(description);
 }
 
@@ -166,7 +163,6 @@ void ServiceHandle::addPool(const std::string& config,
                             AsyncRequest*      req) const {
     if (not self) throw BEDROCK_DETAILED_EXCEPTION("Invalid bedrock::ServiceHandle object");
     auto& rpc = self->m_client->m_add_pool;
-    auto& ph  = self->m_ph;
     SEND_RPC_WITH_BOOL_RESULT(config);
 }
 
@@ -174,7 +170,6 @@ void ServiceHandle::addXstream(const std::string& config,
                                AsyncRequest*      req) const {
     if (not self) throw BEDROCK_DETAILED_EXCEPTION("Invalid bedrock::ServiceHandle object");
     auto& rpc = self->m_client->m_add_xstream;
-    auto& ph  = self->m_ph;
     SEND_RPC_WITH_BOOL_RESULT(config);
 }
 
@@ -182,7 +177,6 @@ void ServiceHandle::removePool(const std::string& name,
                                AsyncRequest*      req) const {
     if (not self) throw BEDROCK_DETAILED_EXCEPTION("Invalid bedrock::ServiceHandle object");
     auto& rpc = self->m_client->m_remove_pool;
-    auto& ph  = self->m_ph;
     SEND_RPC_WITH_BOOL_RESULT(name);
 }
 
@@ -190,67 +184,92 @@ void ServiceHandle::removeXstream(const std::string& name,
                                   AsyncRequest*      req) const {
     if (not self) throw BEDROCK_DETAILED_EXCEPTION("Invalid bedrock::ServiceHandle object");
     auto& rpc = self->m_client->m_remove_xstream;
-    auto& ph  = self->m_ph;
     SEND_RPC_WITH_BOOL_RESULT(name);
 }
 
 void ServiceHandle::getConfig(std::string* result, AsyncRequest* req) const {
     if (not self) throw BEDROCK_DETAILED_EXCEPTION("Invalid bedrock::ServiceHandle object");
-    auto& rpc = self->m_client->m_get_config;
-    auto& ph  = self->m_ph;
-    if (req == nullptr) { // synchronous call
-        RequestResult<std::string> response = rpc.on(ph)();
-        if (response.success()) {
-            if (result) *result = std::move(response.value());
-        } else {
-            throw BEDROCK_DETAILED_EXCEPTION(response.error());
+    auto on_legacy_success = [result](std::string& content) {
+        if (result) *result = std::move(content);
+    };
+    if (self->m_legacy_server) {
+        auto& rpc = self->m_client->m_get_config;
+        SEND_RPC(std::string, on_legacy_success);
+        return;
+    }
+    auto& rpc      = self->m_client->m_get_config_encoded;
+    auto  encoding = static_cast<uint8_t>(Encoding::JSON);
+    auto on_success = [self=self, result](BulkResponse& response) {
+        auto content = self->extractResponse(response);
+        if (result) *result = std::move(content);
+    };
+    auto fallback = [self=self, on_legacy_success]() {
+        self->sendLegacy(self->m_client->m_get_config, on_legacy_success);
+    };
+    SEND_RPC_WITH_FALLBACK(BulkResponse, on_success, fallback, encoding);
+}
+
+void ServiceHandle::getConfigJSON(nlohmann::json* config, AsyncRequest* req) const {
+    if (not self) throw BEDROCK_DETAILED_EXCEPTION("Invalid bedrock::ServiceHandle object");
+    auto decode = [](const std::string& content, Encoding encoding) {
+        try {
+            return decodeJSON(content, encoding);
+        } catch (const nlohmann::json::exception& ex) {
+            throw BEDROCK_DETAILED_EXCEPTION("Could not decode configuration: {}", ex.what());
         }
-    } else { // asynchronous call
-        auto async_response = rpc.on(ph).async();
-        auto async_request_impl
-            = std::make_shared<AsyncThalliumResponse>(std::move(async_response));
-        async_request_impl->m_wait_callback
-            = [result](AsyncThalliumResponse& async_request_impl) {
-                  RequestResult<std::string> response
-                      = async_request_impl.m_async_response.wait();
-                  if (response.success()) {
-                      if (result) *result = std::move(response.value());
-                  } else {
-                      throw BEDROCK_DETAILED_EXCEPTION(response.error());
-                  }
-              };
-        *req = AsyncRequest(std::move(async_request_impl));
+    };
+    auto on_legacy_success = [config, decode](std::string& content) {
+        auto result = decode(content, Encoding::JSON);
+        if (config) *config = std::move(result);
+    };
+    if (self->m_legacy_server) {
+        auto& rpc = self->m_client->m_get_config;
+        SEND_RPC(std::string, on_legacy_success);
+        return;
     }
+    auto& rpc      = self->m_client->m_get_config_encoded;
+    auto  encoding = static_cast<uint8_t>(Encoding::CBOR);
+    auto on_success = [self=self, config, decode](BulkResponse& response) {
+        auto content = self->extractResponse(response);
+        auto result  = decode(content, encodingFromValue(response.encoding));
+        if (config) *config = std::move(result);
+    };
+    auto fallback = [self=self, on_legacy_success]() {
+        self->sendLegacy(self->m_client->m_get_config, on_legacy_success);
+    };
+    SEND_RPC_WITH_FALLBACK(BulkResponse, on_success, fallback, encoding);
+}
+
+void ServiceHandle::getConfigSince(uint64_t generation, std::string* changes,
+                                   AsyncRequest* req) const {
+    if (not self) throw BEDROCK_DETAILED_EXCEPTION("Invalid bedrock::ServiceHandle object");
+    auto& rpc = self->m_client->m_get_config_since;
+    auto on_success = [changes](std::string& response) {
+        if (changes) *changes = std::move(response);
+    };
+    SEND_RPC(std::string, on_success, generation);
 }
 
 void ServiceHandle::queryConfig(const std::string& script, std::string* result,
                                 AsyncRequest* req) const {
     if (not self) throw BEDROCK_DETAILED_EXCEPTION("Invalid bedrock::ServiceHandle object");
-    auto& rpc = self->m_client->m_query_config;
-    auto& ph  = self->m_ph;
-    if (req == nullptr) { // synchronous call
-        RequestResult<std::string> response = rpc.on(ph)(script);
-        if (response.success()) {
-            if (result) *result = std::move(response.value());
-        } else {
-            throw BEDROCK_DETAILED_EXCEPTION(response.error());
-        }
-    } else { // asynchronous call
-        auto async_response = rpc.on(ph).async(script);
-        auto async_request_impl
-            = std::make_shared<AsyncThalliumResponse>(std::move(async_response));
-        async_request_impl->m_wait_callback
-            = [result](AsyncThalliumResponse& async_request_impl) {
-                  RequestResult<std::string> response
-                      = async_request_impl.m_async_response.wait();
-                  if (response.success()) {
-                      if (result) *result = std::move(response.value());
-                  } else {
-                      throw BEDROCK_DETAILED_EXCEPTION(response.error());
-                  }
-              };
-        *req = AsyncRequest(std::move(async_request_impl));
+    auto on_legacy_success = [result](std::string& content) {
+        if (result) *result = std::move(content);
+    };
+    if (self->m_legacy_server) {
+        auto& rpc = self->m_client->m_query_config;
+        SEND_RPC(std::string, on_legacy_success, script);
+        return;
     }
+    auto& rpc = self->m_client->m_query_config_bulk;
+    auto on_success = [self=self, result](BulkResponse& response) {
+        auto content = self->extractResponse(response);
+        if (result) *result = std::move(content);
+    };
+    auto fallback = [self=self, on_legacy_success, script]() {
+        self->sendLegacy(self->m_client->m_query_config, on_legacy_success, script);
+    };
+    SEND_RPC_WITH_FALLBACK(BulkResponse, on_success, fallback, script);
 }
 
 } // namespace bedrock
@@ -7,6 +7,13 @@
 #define __ALPHA_SERVICE_HANDLE_IMPL_H
 
 #include "ClientImpl.hpp"
+#include "AsyncRequestImpl.hpp"
+#include <bedrock/RequestResult.hpp>
+#include <bedrock/DetailedException.hpp>
+#include <spdlog/spdlog.h>
+#include <atomic>
+#include <cstring>
+#include <functional>
 
 namespace bedrock {
 
@@ -15,12 +22,164 @@ class ServiceHandleImpl {
   public:
     std::shared_ptr<ClientImpl> m_client;
     tl::provider_handle         m_ph;
+    // set once the server is known to be running a version of Bedrock
+    // that does not define the RPCs returning a BulkResponse
+    mutable std::atomic<bool>   m_legacy_server{false};
 
     ServiceHandleImpl() = default;
 
     ServiceHandleImpl(const std::shared_ptr<ClientImpl>& client,
                       tl::provider_handle&&              ph)
     : m_client(client), m_ph(std::move(ph)) {}
+
+    /**
+     * @brief Sends the RPC synchronously, invalidating the cached
+     * endpoint for the target address if the RPC fails.
+     */
+    template<typename ... Args>
+    auto forward(const tl::remote_procedure& rpc, Args&&... args) const {
+        try {
+            return rpc.on(m_ph)(std::forward<Args>(args)...);
+        } catch(const tl::exception&) {
+            m_client->m_endpoints->invalidate(m_ph);
+            throw;
+        }
+    }
+
+    /**
+     * @brief Sends an RPC returning a RequestResult<T> and passes its value
+     * to on_success, throwing an Exception if the request failed.
+     *
+     * If async is false, the call is synchronous and nullptr is returned.
+     * Otherwise the RPC is only issued and the returned request completes
+     * it when waited on, so that any number of RPCs can be in flight at
+     * the same time (e.g. to all the members of a ServiceGroupHandle).
+     * In both cases, the cached endpoint of the target is invalidated if
+     * the RPC itself fails.
+     */
+    template<typename T, typename OnSuccess, typename ... Args>
+    std::shared_ptr<AsyncRequestImpl> send(const tl::remote_procedure& rpc, bool async,
+                                           OnSuccess&& on_success, Args&&... args) const {
+        return sendWithFallback<T>(rpc, async, std::forward<OnSuccess>(on_success),
+                                   std::function<void()>{}, std::forward<Args>(args)...);
+    }
+
+    /**
+     * @brief Same as send, but if the server does not define the RPC,
+     * fallback is called (when the request is waited on, if async) instead
+     * of throwing. This is used to retry with an older RPC (see sendLegacy).
+     * Any other failure of the RPC is reported as with send.
+     */
+    template<typename T, typename OnSuccess, typename ... Args>
+    std::shared_ptr<AsyncRequestImpl> sendWithFallback(const tl::remote_procedure& rpc, bool async,
+                                                       OnSuccess&& on_success,
+                                                       std::function<void()> fallback,
+                                                       Args&&... args) const {
+        if (!async) {
+            RequestResult<T> response;
+            try {
+                response = forward(rpc, std::forward<Args>(args)...);
+            } catch(const tl::exception& ex) {
+                if (!fallback || !isNotRegistered(ex)) throw;
+                fallback();
+                return nullptr;
+            }
+            if (!response.success()) throw BEDROCK_DETAILED_EXCEPTION(response.error());
+            on_success(response.value());
+            return nullptr;
+        }
+        std::shared_ptr<AsyncThalliumResponse> async_request_impl;
+        try {
+            async_request_impl = std::make_shared<AsyncThalliumResponse>(
+                rpc.on(m_ph).async(std::forward<Args>(args)...));
+            async_request_impl->m_mid = m_client->m_engine.get_margo_instance();
+        } catch(const tl::exception&) {
+            m_client->m_endpoints->invalidate(m_ph);
+            throw;
+        }
+        async_request_impl->m_wait_callback =
+            [client=m_client, ph=m_ph, on_success=std::forward<OnSuccess>(on_success),
+             fallback=std::move(fallback)]
+            (AsyncThalliumResponse& async_request_impl) mutable {
+                RequestResult<T> response;
+                try {
+                    response = async_request_impl.m_async_response.wait();
+                } catch(const tl::exception& ex) {
+                    if (fallback && isNotRegistered(ex)) {
+                        fallback();
+                        return;
+                    }
+                    client->m_endpoints->invalidate(ph);
+                    throw;
+                }
+                if (!response.success()) throw BEDROCK_DETAILED_EXCEPTION(response.error());
+                try {
+                    on_success(response.value());
+                } catch(const tl::exception&) {
+                    client->m_endpoints->invalidate(ph);
+                    throw;
+                }
+            };
+        return async_request_impl;
+    }
+
+    /**
+     * @brief Synchronously sends an RPC returning a RequestResult<std::string>
+     * that older versions of Bedrock define instead of the RPCs returning a
+     * BulkResponse, remembering that the server is such a version unless the
+     * RPC itself fails. Only called once the server reported that it does
+     * not define the newer RPC (see sendWithFallback).
+     */
+    template<typename OnSuccess, typename ... Args>
+    void sendLegacy(const tl::remote_procedure& rpc, OnSuccess&& on_success,
+                    Args&&... args) const {
+        try {
+            send<std::string>(rpc, false, std::forward<OnSuccess>(on_success),
+                              std::forward<Args>(args)...);
+        } catch(const Exception&) {
+            m_legacy_server = true;
+            throw;
+        }
+        m_legacy_server = true;
+    }
+
+    /**
+     * @brief Extracts the content of a response. Small contents are sent
+     * inline. Larger ones are exposed by the server, and pulled into a
+     * buffer of exactly their size before the server is told to release them.
+     */
+    std::string extractResponse(BulkResponse& response) const {
+        if (!response.in_bulk) return std::move(response.inlined);
+        std::string content(response.size, '\0');
+        auto local = m_client->m_engine.expose(
+            {{content.data(), content.size()}}, tl::bulk_mode::write_only);
+        try {
+            response.bulk.on(m_ph) >> local;
+        } catch(...) {
+            releaseResponse(response.id);
+            throw;
+        }
+        releaseResponse(response.id);
+        return content;
+    }
+
+    /**
+     * @brief Whether an RPC failed because the server does not define it
+     * (Mercury's HG_NO_MATCH, which thallium only reports in the message).
+     */
+    static bool isNotRegistered(const tl::exception& ex) {
+        return std::strstr(ex.what(), "HG_NO_MATCH") != nullptr;
+    }
+
+    void releaseResponse(uint64_t id) const {
+        try {
+            // the RPC has no response, this does not wait for the server
+            m_client->m_release_response.on(m_ph)(id);
+        } catch(const tl::exception& ex) {
+            // the server drops the response by itself after some time
+            spdlog::warn("Could not release response {} on the server: {}", id, ex.what());
+        }
+    }
 };
 
 } // namespace bedrock
@@ -0,0 +1,180 @@
+/*
+ * (C) 2024 The University of Chicago
+ *
+ * See COPYRIGHT in top-level directory.
+ */
+#ifndef BEDROCK_STARTUP_REPORT_H
+#define BEDROCK_STARTUP_REPORT_H
+
+#include <nlohmann/json.hpp>
+#include <fmt/format.h>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace bedrock {
+
+using nlohmann::json;
+
+/**
+ * @brief Collects the timing of the steps of a server's startup: its
+ * phases (parsing, Jx9, Margo initialization, etc.), the loading of each
+ * module, and the dependency resolution and construction of each provider.
+ *
+ * Steps can be recorded from any thread. This class uses an std::mutex
+ * rather than a tl::mutex because modules are loaded from a thread that
+ * may run before Argobots is initialized.
+ */
+class StartupReport {
+
+  public:
+
+    using clock = std::chrono::steady_clock;
+
+    struct Event {
+        std::string name;
+        const char* category;
+        double      start;    // ms since the start of the report
+        double      duration; // ms
+        size_t      thread;   // index of the thread, 0 for the main one
+    };
+
+    /**
+     * @brief Records the duration of a step until end() is called
+     * or the Span is destroyed. A Span created with a null report
+     * does nothing.
+     */
+    class Span {
+
+        StartupReport*    m_report;
+        std::string       m_name;
+        const char*       m_category;
+        clock::time_point m_start = clock::now();
+
+      public:
+
+        Span(StartupReport* report, std::string name, const char* category)
+        : m_report(report), m_name(std::move(name)), m_category(category) {}
+
+        Span(const Span&) = delete;
+        Span& operator=(const Span&) = delete;
+
+        ~Span() { end(); }
+
+        void end() {
+            if (!m_report) return;
+            m_report->record(std::move(m_name), m_category, m_start, clock::now());
+            m_report = nullptr;
+        }
+    };
+
+    StartupReport() {
+        m_threads.emplace(std::this_thread::get_id(), 0);
+    }
+
+    /**
+     * @brief Ends the current phase of the main thread, which started
+     * when the previous phase ended.
+     */
+    void phase(const char* name) {
+        auto now = clock::now();
+        record(name, "phase", m_last, now);
+        m_last = now;
+    }
+
+    /**
+     * @brief Records a step that ran from start to end on the calling thread.
+     */
+    void record(std::string name, const char* category,
+                clock::time_point start, clock::time_point end) {
+        std::lock_guard<std::mutex> lock(m_mtx);
+        auto thread = m_threads.emplace(std::this_thread::get_id(), m_threads.size()).first->second;
+        m_events.push_back(Event{std::move(name), category,
+                                 elapsedMs(m_start, start), elapsedMs(start, end), thread});
+    }
+
+    /**
+     * @brief Calls f and records its duration.
+     */
+    template<typename Function>
+    auto measure(std::string name, const char* category, Function&& f) {
+        Span span{this, std::move(name), category};
+        return f();
+    }
+
+    /**
+     * @brief Returns the report as a JSON object of the form
+     * {"total_ms":<total>, "<category>":[{"name":<name>,"start_ms":<start>,
+     * "duration_ms":<duration>}, ...], ...}, with categories "phase",
+     * "module", "dependencies" and "provider".
+     */
+    json toJSON() const {
+        std::lock_guard<std::mutex> lock(m_mtx);
+        auto report = json::object();
+        report["total_ms"] = elapsedMs(m_start, m_last);
+        for (auto& event : m_events) {
+            auto& list = report[event.category];
+            if (list.is_null()) list = json::array();
+            list.push_back(json{{"name", event.name},
+                                {"start_ms", event.start},
+                                {"duration_ms", event.duration}});
+        }
+        return report;
+    }
+
+    /**
+     * @brief Returns the report in the Chrome trace-event format
+     * (as complete events), which can be opened in chrome://tracing
+     * or Perfetto.
+     *
+     * @param pid Process ID to use in the trace (e.g. the MPI rank).
+     */
+    json toChromeTrace(int pid) const {
+        std::lock_guard<std::mutex> lock(m_mtx);
+        auto events = json::array();
+        for (auto& event : m_events) {
+            events.push_back(json{{"name", event.name},
+                                  {"cat", event.category},
+                                  {"ph", "X"},
+                                  {"ts", event.start * 1000.0},
+                                  {"dur", event.duration * 1000.0},
+                                  {"pid", pid},
+                                  {"tid", event.thread}});
+        }
+        return json{{"traceEvents", std::move(events)}, {"displayTimeUnit", "ms"}};
+    }
+
+    /**
+     * @brief Returns a one-line summary of the phases, for logging.
+     */
+    std::string summary() const {
+        std::lock_guard<std::mutex> lock(m_mtx);
+        std::string result;
+        for (auto& event : m_events) {
+            if (std::string{event.category} != "phase") continue;
+            result += fmt::format("{}: {:.3f} ms, ", event.name, event.duration);
+        }
+        result += fmt::format("total: {:.3f} ms", elapsedMs(m_start, m_last));
+        return result;
+    }
+
+  private:
+
+    static double elapsedMs(clock::time_point from, clock::time_point to) {
+        return std::chrono::duration<double, std::milli>(to - from).count();
+    }
+
+    clock::time_point                            m_start = clock::now();
+    clock::time_point                            m_last  = m_start; // main thread only
+    std::vector<Event>                           m_events;
+    std::unordered_map<std::thread::id, size_t> m_threads;
+    mutable std::mutex                           m_mtx;
+};
+
+} // namespace bedrock
+
+#endif
@@ -0,0 +1,48 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/catch_all.hpp>
+#include "AddressTable.hpp"
+#include <string>
+#include <vector>
+
+TEST_CASE("Tests the address table", "[address-table]") {
+
+    SECTION("Empty table") {
+        bedrock::AddressTable table;
+        REQUIRE(table.empty());
+        REQUIRE(table.size() == 0);
+        REQUIRE(bedrock::AddressTable::fromAddresses({}).empty());
+    }
+
+    SECTION("Distinct addresses") {
+        std::vector<std::string> addresses;
+        for(int i = 0; i < 1000; ++i)
+            addresses.push_back("ofi+tcp;ofi_rxm://10.0." + std::to_string(i / 100)
+                                + "." + std::to_string(i % 100) + ":" + std::to_string(50000 + i));
+        auto table = bedrock::AddressTable::fromAddresses(addresses);
+        REQUIRE(table.size() == addresses.size());
+        for(size_t i = 0; i < addresses.size(); ++i)
+            REQUIRE(table[i] == addresses[i]);
+        size_t total = 0;
+        for(auto& address : addresses) total += address.size();
+        REQUIRE(table.memoryUsage() < total);
+    }
+
+    SECTION("Duplicate and prefix-only addresses") {
+        std::vector<std::string> addresses = {
+            "na+sm://1234-0", "na+sm://1234-1", "na+sm://1234-0",
+            "na+sm://1234", "na+sm://1234-1"
+        };
+        auto table = bedrock::AddressTable::fromAddresses(addresses);
+        REQUIRE(table.size() == addresses.size());
+        for(size_t i = 0; i < addresses.size(); ++i)
+            REQUIRE(table[i] == addresses[i]);
+    }
+
+    SECTION("Identical addresses") {
+        std::vector<std::string> addresses(8, "na+sm://1234-0");
+        auto table = bedrock::AddressTable::fromAddresses(addresses);
+        REQUIRE(table.size() == addresses.size());
+        for(size_t i = 0; i < addresses.size(); ++i)
+            REQUIRE(table[i] == addresses[i]);
+    }
+}
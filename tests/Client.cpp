@@ -2,8 +2,14 @@
 #include <catch2/catch_all.hpp>
 #include <bedrock/Server.hpp>
 #include <bedrock/Client.hpp>
+#include <bedrock/ServiceGroupHandle.hpp>
 #include <nlohmann/json.hpp>
+#include <algorithm>
+#include <chrono>
 #include <fstream>
+#include <limits>
+#include <future>
+#include <vector>
 
 using json = nlohmann::json;
 
@@ -180,7 +186,282 @@ TEST_CASE("Tests various object creation and removal via a ServiceHandle", "[ser
                 R"({"name":"my_provider_x", "type":"module_x", "provider_id":234})",
                 nullptr, &req);
             REQUIRE_THROWS_AS(req.wait(), bedrock::Exception);
+
+            // create a batch of providers with a single RPC
+            std::vector<bedrock::RequestResult<uint16_t>> results;
+            serviceHandle.addProviders(json::parse(R"([
+                {"name":"my_provider_a5", "type":"module_a", "provider_id":40},
+                {"name":"my_provider_y", "type":"module_x"},
+                {"name":"my_provider_a6", "type":"module_a"}])"), &results);
+            REQUIRE(results.size() == 3);
+            REQUIRE(results[0].success());
+            REQUIRE(results[0].value() == 40);
+            REQUIRE(!results[1].success());
+            REQUIRE(!results[1].error().empty());
+            REQUIRE(results[2].success());
+            REQUIRE(results[2].value() == 3);
+            REQUIRE(server.getProviderManager().lookupProvider("my_provider_a6") != nullptr);
+            REQUIRE_THROWS_AS(serviceHandle.addProviders(json::object()), bedrock::Exception);
+            // same with a group, one batch per member, asynchronously
+            auto group = client.makeServiceGroupHandle({static_cast<std::string>(engine.self())}, 0);
+            std::vector<std::vector<bedrock::RequestResult<uint16_t>>> group_results;
+            group.addProviders({json::parse(R"([
+                {"name":"my_provider_a7", "type":"module_a"},
+                {"name":"my_provider_a5", "type":"module_a"}])")},
+                &group_results, &req);
+            req.wait();
+            REQUIRE(group_results.size() == 1);
+            REQUIRE(group_results[0].size() == 2);
+            REQUIRE(group_results[0][0].success());
+            REQUIRE(!group_results[0][1].success()); // name already used
+            REQUIRE_THROWS_AS(group.addProviders({}), bedrock::Exception);
+        }
+
+        SECTION("Get the configuration changes") {
+            std::string changes;
+            // an unknown generation gives the full configuration
+            serviceHandle.getConfigSince(0, &changes);
+            auto c = json::parse(changes);
+            REQUIRE(c.contains("config"));
+            auto generation = c["generation"].get<uint64_t>();
+            auto config = c["config"];
+            REQUIRE(config == json::parse(server.getCurrentConfig()));
+            // nothing changed since that generation
+            serviceHandle.getConfigSince(generation, &changes);
+            c = json::parse(changes);
+            REQUIRE(c["unchanged"] == true);
+            REQUIRE(c["generation"] == generation);
+            // adding a pool gives a patch, asynchronously
+            serviceHandle.addPool("{\"name\":\"my_pool4\",\"kind\":\"fifo_wait\",\"access\":\"mpmc\"}");
+            bedrock::AsyncRequest req;
+            serviceHandle.getConfigSince(generation, &changes, &req);
+            req.wait();
+            c = json::parse(changes);
+            REQUIRE(c.contains("patch"));
+            REQUIRE(c["generation"].get<uint64_t>() > generation);
+            config = config.patch(c["patch"]);
+            REQUIRE(config == json::parse(server.getCurrentConfig()));
+            serviceHandle.removePool("my_pool4");
+        }
+
+        SECTION("Receive large responses through a bulk") {
+            std::string script = "return str_repeat('x', 100000);";
+            std::string result;
+            // the response is pulled from the server
+            serviceHandle.queryConfig(script, &result);
+            REQUIRE(result == std::string(100000, 'x'));
+            // small responses are still sent inline
+            serviceHandle.queryConfig("return 42;", &result);
+            REQUIRE(result == "42");
+            // same asynchronously
+            bedrock::AsyncRequest req;
+            serviceHandle.queryConfig(script, &result, &req);
+            req.wait();
+            REQUIRE(result == std::string(100000, 'x'));
+            serviceHandle.getConfig(&result);
+            REQUIRE(json::parse(result) == json::parse(server.getCurrentConfig()));
+        }
+
+        SECTION("Get the configuration as a JSON document") {
+            json config;
+            serviceHandle.getConfigJSON(&config);
+            REQUIRE(config == json::parse(server.getCurrentConfig()));
+            bedrock::AsyncRequest req;
+            config = nullptr;
+            serviceHandle.getConfigJSON(&config, &req);
+            req.wait();
+            REQUIRE(config == json::parse(server.getCurrentConfig()));
+        }
+
+        SECTION("Query the configuration repeatedly") {
+            // the same script is compiled once and its VM reused
+            std::string script = "return count($__config__['margo']['argobots']['pools']);";
+            std::string result;
+            serviceHandle.queryConfig(script, &result);
+            auto num_pools = std::stoi(result);
+            serviceHandle.addPool("{\"name\":\"my_pool3\",\"kind\":\"fifo_wait\",\"access\":\"mpmc\"}");
+            serviceHandle.queryConfig(script, &result);
+            REQUIRE(std::stoi(result) == num_pools + 1);
+            serviceHandle.removePool("my_pool3");
+            serviceHandle.queryConfig(script, &result);
+            REQUIRE(std::stoi(result) == num_pools);
+            // a script that does not use the configuration
+            serviceHandle.queryConfig("return 42;", &result);
+            REQUIRE(result == "42");
+            // variables set by a previous run do not leak into the next one
+            std::string leaky = "$r = is_null($x); $x = 1; return $r;";
+            serviceHandle.queryConfig(leaky, &result);
+            REQUIRE(result == "true");
+            serviceHandle.queryConfig(leaky, &result);
+            REQUIRE(result == "true");
+            // a script that fails to compile fails every time
+            REQUIRE_THROWS_AS(serviceHandle.queryConfig("+&*", &result), bedrock::Exception);
+            REQUIRE_THROWS_AS(serviceHandle.queryConfig("+&*", &result), bedrock::Exception);
+        }
+
+        SECTION("Query the configuration concurrently") {
+            std::vector<std::string> results(8);
+            std::vector<bedrock::AsyncRequest> reqs(8);
+            for(unsigned i = 0; i < reqs.size(); ++i) {
+                auto script = "return " + std::to_string(i) + " + count($__config__['providers']);";
+                serviceHandle.queryConfig(script, &results[i], &reqs[i]);
+            }
+            for(unsigned i = 0; i < reqs.size(); ++i) {
+                reqs[i].wait();
+                REQUIRE(results[i] == std::to_string(i));
+            }
+        }
+
+        SECTION("Continuations and partial waits") {
+            auto pool = engine.get_handler_pool();
+            // the continuation runs once the result is available
+            std::string result;
+            bedrock::AsyncRequest req;
+            thallium::eventual<std::string> value;
+            serviceHandle.queryConfig("return 42;", &result, &req);
+            req.then([&](const bedrock::Exception* error) {
+                value.set_value(error ? "" : result);
+            }, pool);
+            REQUIRE(!req);
+            REQUIRE(value.wait() == "42");
+            // errors are passed to the continuation
+            thallium::eventual<std::string> error_message;
+            serviceHandle.queryConfig("+&*", &result, &req);
+            req.then([&](const bedrock::Exception* error) {
+                error_message.set_value(error ? error->what() : "");
+            }, pool);
+            REQUIRE(!error_message.wait().empty());
+            // futures, polled since this ULT runs on the pool completing them
+            serviceHandle.queryConfig("return 43;", &result, &req);
+            auto future = req.toFuture(pool);
+            while(future.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+                thallium::thread::yield();
+            future.get();
+            REQUIRE(result == "43");
+            serviceHandle.queryConfig("+&*", &result, &req);
+            future = req.toFuture(pool);
+            while(future.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+                thallium::thread::yield();
+            REQUIRE_THROWS_AS(future.get(), bedrock::Exception);
+            // waitSome and waitAny
+            std::vector<std::string> results(8);
+            std::vector<bedrock::AsyncRequest> reqs(8);
+            for(unsigned i = 0; i < reqs.size(); ++i)
+                serviceHandle.queryConfig("return " + std::to_string(i) + ";", &results[i], &reqs[i]);
+            auto indices = bedrock::AsyncRequest::waitSome(reqs);
+            REQUIRE(!indices.empty());
+            size_t num_completed = indices.size();
+            for(auto i : indices) REQUIRE(results[i] == std::to_string(i));
+            size_t i;
+            while((i = bedrock::AsyncRequest::waitAny(reqs)) != reqs.size()) {
+                REQUIRE(results[i] == std::to_string(i));
+                num_completed += 1;
+            }
+            REQUIRE(num_completed == reqs.size());
+            REQUIRE(bedrock::AsyncRequest::waitSome(reqs).empty());
+        }
+
+        SECTION("Pipelined requests") {
+            constexpr unsigned N = 16;
+            // every asynchronous operation returns a live request
+            std::vector<std::string> configs(N);
+            std::vector<bedrock::AsyncRequest> reqs(N);
+            for(unsigned i = 0; i < N; ++i) {
+                serviceHandle.getConfig(&configs[i], &reqs[i]);
+                REQUIRE(static_cast<bool>(reqs[i]));
+            }
+            REQUIRE_THROWS_AS(serviceHandle.getConfig(&configs[0], &reqs[0]), bedrock::Exception);
+            for(auto& r : reqs) r.wait();
+            for(auto& c : configs) REQUIRE(json::parse(c) == json::parse(server.getCurrentConfig()));
+        }
+
+        SECTION("Tree-based collective operations") {
+            auto self_address = static_cast<std::string>(engine.self());
+            auto group = client.makeServiceGroupHandle(std::vector<std::string>(7, self_address), 0);
+            std::string flat_config, flat_query;
+            group.getConfig(&flat_config);
+            group.queryConfig("return 42;", &flat_query);
+            for(uint32_t k : {1, 2, 3, 8}) {
+                group.setTreeFanout(k);
+                std::string config, query;
+                group.getConfig(&config);
+                REQUIRE(json::parse(config) == json::parse(flat_config));
+                bedrock::AsyncRequest req;
+                group.queryConfig("return 42;", &query, &req);
+                req.wait();
+                REQUIRE(json::parse(query) == json::parse(flat_query));
+                REQUIRE(json::parse(query)[self_address] == 42);
+                // the members share an address, so count the visits to
+                // detect dropped or duplicated members
+                std::string visits;
+                group.mapReduceConfig("return 1;", "return $__values__[0] + $__values__[1];", &visits);
+                REQUIRE(json::parse(visits) == 7);
+                // errors from any member are reported
+                REQUIRE_THROWS_AS(group.queryConfig("+&*", &query), bedrock::Exception);
+            }
+            group.setTreeFanout(0);
+        }
+
+        SECTION("Map-reduce queries") {
+            auto self_address = static_cast<std::string>(engine.self());
+            auto group = client.makeServiceGroupHandle(std::vector<std::string>(5, self_address), 0);
+            std::string count;
+            serviceHandle.queryConfig("return count($__config__['margo']['argobots']['pools']);", &count);
+            auto map      = "return count($__config__['margo']['argobots']['pools']);";
+            auto sum      = "return $__values__[0] + $__values__[1];";
+            auto expected = 5 * std::stoi(count);
+            for(uint32_t k : {0, 1, 2}) {
+                group.setTreeFanout(k);
+                std::string result;
+                group.mapReduceConfig(map, sum, &result);
+                REQUIRE(json::parse(result) == expected);
+                bedrock::AsyncRequest req;
+                group.mapReduceConfig("return 1;", sum, &result, &req);
+                req.wait();
+                REQUIRE(json::parse(result) == 5);
+                REQUIRE_THROWS_AS(group.mapReduceConfig(map, "+&*", &result), bedrock::Exception);
+                REQUIRE_THROWS_AS(group.mapReduceConfig(map, "", &result), bedrock::Exception);
+            }
+        }
+    }
+    server.finalize();
+}
+
+TEST_CASE("Concurrent queries overlap", "[service-handle]") {
+
+    auto config = R"({"margo":{"rpc_thread_count":4}})";
+    bedrock::Server server("na+sm", config);
+    {
+        auto engine = server.getMargoManager().getThalliumEngine();
+        bedrock::Client client(engine);
+        auto serviceHandle = client.makeServiceHandle(engine.self(), 0);
+        // each query records when it starts and ends executing
+        auto script = "$start = microtime(true); usleep(200000); return [$start, microtime(true)];";
+        std::vector<std::string> results(4);
+        std::vector<bedrock::AsyncRequest> reqs(4);
+        for(unsigned i = 0; i < reqs.size(); ++i)
+            serviceHandle.queryConfig(script, &results[i], &reqs[i]);
+        double last_start = 0.0, first_end = std::numeric_limits<double>::max();
+        for(unsigned i = 0; i < reqs.size(); ++i) {
+            reqs[i].wait();
+            auto interval = json::parse(results[i]);
+            last_start = std::max(last_start, interval[0].get<double>());
+            first_end  = std::min(first_end, interval[1].get<double>());
         }
+        // all the queries were executing at the same time
+        REQUIRE(last_start < first_end);
+        // a group sends its RPCs without waiting for the previous ones,
+        // so it takes about one delay rather than one per member
+        using clock = std::chrono::steady_clock;
+        auto delay = std::chrono::milliseconds(200);
+        auto group = client.makeServiceGroupHandle(
+            std::vector<std::string>(4, static_cast<std::string>(engine.self())), 0);
+        std::string result;
+        auto t0 = clock::now();
+        group.queryConfig("usleep(200000); return 1;", &result);
+        auto elapsed = clock::now() - t0;
+        REQUIRE(elapsed >= delay);
+        REQUIRE(elapsed < 2 * delay);
     }
     server.finalize();
 }
@@ -0,0 +1,81 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/catch_all.hpp>
+#include "DependencySpec.hpp"
+#include <regex>
+#include <string>
+#include <vector>
+
+TEST_CASE("Tests dependency specification parsing", "[dependency-spec]") {
+
+    bedrock::DependencySpec spec;
+
+    SECTION("Valid specifications") {
+        REQUIRE(bedrock::parseDependencySpec("my_provider", spec));
+        REQUIRE(spec.identifier == "my_provider");
+        REQUIRE(spec.provider_id_str.empty());
+        REQUIRE(!spec.has_locator);
+
+        REQUIRE(bedrock::parseDependencySpec("module_a:42", spec));
+        REQUIRE(spec.identifier == "module_a");
+        REQUIRE(spec.provider_id_str == "42");
+        REQUIRE(spec.provider_id == 42);
+        REQUIRE(!spec.has_locator);
+
+        REQUIRE(bedrock::parseDependencySpec("_p2@local", spec));
+        REQUIRE(spec.identifier == "_p2");
+        REQUIRE(spec.provider_id_str.empty());
+        REQUIRE(spec.has_locator);
+        REQUIRE(spec.locator == "local");
+
+        REQUIRE(bedrock::parseDependencySpec("module_a:3@na+sm://1234-0", spec));
+        REQUIRE(spec.identifier == "module_a");
+        REQUIRE(spec.provider_id == 3);
+        REQUIRE(spec.locator == "na+sm://1234-0");
+    }
+
+    SECTION("Ill-formed specifications") {
+        for(auto s : {"", "1abc", "abc:", "abc:x", "abc@", "abc:1@", "ab-c", "abc:12x", ":12"}) {
+            CAPTURE(s);
+            REQUIRE(!bedrock::parseDependencySpec(s, spec));
+        }
+    }
+
+    SECTION("Rank locators") {
+        int rank = -1;
+        REQUIRE(bedrock::parseRankLocator("12", rank));
+        REQUIRE(rank == 12);
+        REQUIRE(!bedrock::parseRankLocator("local", rank));
+        REQUIRE(!bedrock::parseRankLocator("na+sm://1234-0", rank));
+    }
+}
+
+TEST_CASE("Benchmark dependency specification parsing", "[.benchmark][dependency-spec]") {
+
+    const std::vector<std::string> specs = {
+        "my_provider", "module_a:42", "my_provider@local",
+        "module_a:3@na+sm://1234-0", "other_provider@12"
+    };
+
+    BENCHMARK("std::regex") {
+        size_t matched = 0;
+        for(auto& s : specs) {
+            std::regex re(
+                "([a-zA-Z_][a-zA-Z0-9_]*)"
+                "(?::([0-9]+))?"
+                "(?:@(.+))?");
+            std::smatch match;
+            if(std::regex_search(s, match, re) && match.str(0) == s)
+                matched += 1;
+        }
+        return matched;
+    };
+
+    BENCHMARK("parseDependencySpec") {
+        size_t matched = 0;
+        bedrock::DependencySpec parsed;
+        for(auto& s : specs)
+            if(bedrock::parseDependencySpec(s, parsed))
+                matched += 1;
+        return matched;
+    };
+}
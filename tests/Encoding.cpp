@@ -0,0 +1,69 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/catch_all.hpp>
+#include "Encoding.hpp"
+#include <string>
+
+using json = nlohmann::json;
+
+// builds a configuration resembling that of a daemon with many providers
+static json makeLargeConfig(size_t num_providers) {
+    auto config = json::object();
+    config["margo"] = {{"argobots", {{"pools", json::array()}, {"xstreams", json::array()}}}};
+    auto providers = json::array();
+    for(size_t i = 0; i < num_providers; ++i) {
+        providers.push_back({
+            {"name", "provider_" + std::to_string(i)},
+            {"type", "module_a"},
+            {"provider_id", i + 1},
+            {"pool", "__primary__"},
+            {"tags", {"tag1", "tag2"}},
+            {"dependencies", {{"dep", "provider_" + std::to_string(i/2) + "@local"}}},
+            {"config", {{"path", "/dev/shm/db_" + std::to_string(i)}, {"size", 1048576},
+                        {"ratio", 0.75}, {"enabled", true}}}
+        });
+    }
+    config["providers"] = std::move(providers);
+    config["libraries"] = json::array();
+    return config;
+}
+
+TEST_CASE("Tests JSON document encodings", "[encoding]") {
+
+    auto config = makeLargeConfig(10);
+
+    SECTION("Round trips") {
+        for(auto encoding : {bedrock::Encoding::JSON,
+                             bedrock::Encoding::CBOR,
+                             bedrock::Encoding::MessagePack}) {
+            CAPTURE(static_cast<int>(encoding));
+            auto encoded = bedrock::encodeJSON(config, encoding);
+            REQUIRE(bedrock::decodeJSON(encoded, encoding) == config);
+        }
+    }
+
+    SECTION("Unknown encodings fall back to JSON") {
+        REQUIRE(bedrock::encodingFromValue(1) == bedrock::Encoding::CBOR);
+        REQUIRE(bedrock::encodingFromValue(2) == bedrock::Encoding::MessagePack);
+        REQUIRE(bedrock::encodingFromValue(42) == bedrock::Encoding::JSON);
+    }
+}
+
+TEST_CASE("Benchmark JSON document encodings", "[.benchmark][encoding]") {
+
+    // about 1 MB when serialized as JSON text
+    auto config = makeLargeConfig(4000);
+    INFO("JSON size: " << config.dump().size());
+
+    for(auto encoding : {bedrock::Encoding::JSON,
+                         bedrock::Encoding::CBOR,
+                         bedrock::Encoding::MessagePack}) {
+        auto name    = std::to_string(static_cast<int>(encoding));
+        auto encoded = bedrock::encodeJSON(config, encoding);
+        BENCHMARK("encode (encoding " + name + ")") {
+            return bedrock::encodeJSON(config, encoding);
+        };
+        BENCHMARK("decode (encoding " + name + ")") {
+            return bedrock::decodeJSON(encoded, encoding);
+        };
+    }
+}
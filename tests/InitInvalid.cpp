@@ -25,6 +25,21 @@ TEST_CASE("Tests Server initialization", "[init-invalid]") {
             REQUIRE_THROWS_AS(
                 bedrock::Server("na+sm", input_config),
                 bedrock::Exception);
+            // errors are reported either when compiling or when starting
+            REQUIRE_THROWS_AS(
+                bedrock::Server("na+sm", bedrock::Server::compileConfig(input_config),
+                                bedrock::ConfigType::COMPILED),
+                bedrock::Exception);
         }
     }
+
+    SECTION("Invalid compiled configuration") {
+        REQUIRE_THROWS_AS(
+            bedrock::Server("na+sm", "{}", bedrock::ConfigType::COMPILED),
+            bedrock::Exception);
+        REQUIRE_THROWS_AS(
+            bedrock::Server::compileConfig(
+                bedrock::Server::compileConfig("{}"), bedrock::ConfigType::COMPILED),
+            bedrock::Exception);
+    }
 }
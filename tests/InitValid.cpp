@@ -4,6 +4,8 @@
 #include <bedrock/MargoManager.hpp>
 #include <bedrock/Client.hpp>
 #include <nlohmann/json.hpp>
+#include <algorithm>
+#include <cstdio>
 #include <fstream>
 
 using json = nlohmann::json;
@@ -40,6 +42,14 @@ TEST_CASE("Tests Server initialization", "[init-json]") {
                     REQUIRE(output_config == expected_config);
                     server.finalize();
                 }
+                SECTION("Initialize from a compiled configuration") {
+                    auto compiled = bedrock::Server::compileConfig(input_config);
+                    bedrock::Server server("na+sm", compiled, bedrock::ConfigType::COMPILED);
+                    auto output_config = json::parse(server.getCurrentConfig());
+                    cleanupOutputConfig(output_config);
+                    REQUIRE(output_config == expected_config);
+                    server.finalize();
+                }
                 SECTION("Get configuration synchronously using a Client") {
                     bedrock::Server server("na+sm", input_config);
                     auto engine = server.getMargoManager().getThalliumEngine();
@@ -98,4 +108,45 @@ kind   = "fifo"
         }
         server.finalize();
     }
+
+    SECTION("Startup report") {
+
+        const std::string input_config = R"(
+{
+    "bedrock": {"startup_trace": "startup-trace.json"},
+    "libraries": ["./libModuleA.so"],
+    "providers": [
+        {"name": "provider_1", "type": "module_a"},
+        {"name": "provider_2", "type": "module_a"}
+    ]
+}
+)";
+        std::remove("startup-trace.json");
+        bedrock::Server server("na+sm", input_config);
+        auto report = json::parse(server.getStartupReport());
+        REQUIRE(report["total_ms"].get<double>() > 0.0);
+        auto names = [&report](const char* category) {
+            std::vector<std::string> result;
+            for(auto& event : report[category])
+                result.push_back(event["name"].get<std::string>());
+            return result;
+        };
+        auto phases = names("phase");
+        REQUIRE(std::find(phases.begin(), phases.end(), "margo") != phases.end());
+        REQUIRE(std::find(phases.begin(), phases.end(), "providers") != phases.end());
+        REQUIRE(names("module") == std::vector<std::string>{"./libModuleA.so"});
+        REQUIRE(names("provider") == std::vector<std::string>{"provider_1", "provider_2"});
+        REQUIRE(names("dependencies").size() == 2);
+
+        auto config = json::parse(server.getCurrentConfig());
+        REQUIRE(!config["bedrock"].contains("startup"));
+        REQUIRE(config["bedrock"]["startup_trace"] == "startup-trace.json");
+
+        std::ifstream trace_file("startup-trace.json");
+        REQUIRE(trace_file.good());
+        auto trace = json::parse(trace_file);
+        REQUIRE(trace["traceEvents"].is_array());
+        REQUIRE(trace["traceEvents"].size() > phases.size());
+        server.finalize();
+    }
 }
@@ -0,0 +1,238 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/catch_all.hpp>
+#include <bedrock/Server.hpp>
+#include <bedrock/Client.hpp>
+#include <bedrock/ProviderManager.hpp>
+#include <bedrock/RequestResult.hpp>
+#include <bedrock/ProviderDescriptor.hpp>
+#include <bedrock/Exception.hpp>
+#include <nlohmann/json.hpp>
+#include <thallium.hpp>
+#include <thallium/serialization/stl/vector.hpp>
+#include <chrono>
+#include <iostream>
+
+namespace tl = thallium;
+using json = nlohmann::json;
+
+static const char* serverConfig = R"({"libraries":["libModuleA.so","libModuleB.so"]})";
+
+static json makeProvider(const std::string& name, const std::string& type = "module_a") {
+    return json{{"name", name}, {"type", type}};
+}
+
+TEST_CASE("Tests provider registration and lookup", "[provider-manager]") {
+
+    bedrock::Server server("na+sm", serverConfig);
+    auto providerManager = server.getProviderManager();
+
+    SECTION("Look up providers by name and by type:id") {
+        auto a = providerManager.addProviderFromJSON(makeProvider("my_provider_a"));
+        auto b = providerManager.addProviderFromJSON(makeProvider("my_provider_b", "module_b"));
+        REQUIRE(providerManager.numProviders() == 2);
+        REQUIRE(a->getProviderID() == 1);
+        REQUIRE(b->getProviderID() == 2);
+
+        REQUIRE(providerManager.lookupProvider("my_provider_a") == a);
+        REQUIRE(providerManager.lookupProvider("module_a:1") == a);
+        REQUIRE(providerManager.lookupProvider("module_b:2") == b);
+        REQUIRE(providerManager.getProvider("my_provider_b") == b);
+        REQUIRE(providerManager.getProvider(1) == b);
+
+        REQUIRE_THROWS_AS(providerManager.lookupProvider("my_provider_c"), bedrock::Exception);
+        REQUIRE_THROWS_AS(providerManager.lookupProvider("module_b:1"), bedrock::Exception);
+        REQUIRE_THROWS_AS(providerManager.lookupProvider("module_a:3"), bedrock::Exception);
+        REQUIRE_THROWS_AS(providerManager.getProvider("module_a:1"), bedrock::Exception);
+    }
+
+    SECTION("Reject duplicate names and provider IDs") {
+        providerManager.addProviderFromJSON(makeProvider("my_provider_a"));
+        REQUIRE_THROWS_AS(
+            providerManager.addProviderFromJSON(makeProvider("my_provider_a", "module_b")),
+            bedrock::Exception);
+        auto b = makeProvider("my_provider_b");
+        b["provider_id"] = 1;
+        REQUIRE_THROWS_AS(providerManager.addProviderFromJSON(b), bedrock::Exception);
+        b["provider_id"] = 42;
+        REQUIRE(providerManager.addProviderFromJSON(b)->getProviderID() == 42);
+        REQUIRE(providerManager.numProviders() == 2);
+    }
+
+    SECTION("Reuse provider IDs and names after deregistration") {
+        for(int i = 0; i < 4; ++i)
+            providerManager.addProviderFromJSON(makeProvider("my_provider_" + std::to_string(i)));
+        providerManager.deregisterProvider("my_provider_1");
+        providerManager.deregisterProvider("module_a:3");
+        REQUIRE(providerManager.numProviders() == 2);
+        REQUIRE_THROWS_AS(providerManager.lookupProvider("module_a:2"), bedrock::Exception);
+        REQUIRE_THROWS_AS(providerManager.deregisterProvider("my_provider_1"), bedrock::Exception);
+
+        auto p = providerManager.addProviderFromJSON(makeProvider("my_provider_1"));
+        REQUIRE(p->getProviderID() == 2);
+        p = providerManager.addProviderFromJSON(makeProvider("my_provider_4"));
+        REQUIRE(p->getProviderID() == 3);
+        p = providerManager.addProviderFromJSON(makeProvider("my_provider_5"));
+        REQUIRE(p->getProviderID() == 5);
+        REQUIRE(providerManager.getProvider(2)->getName() == "my_provider_1");
+    }
+
+    SECTION("Roll back providers created after a failure in a parallel list") {
+        auto engine = server.getMargoManager().getThalliumEngine();
+        bedrock::Client client(engine);
+        auto serviceHandle = client.makeServiceHandle(engine.self(), 0);
+        std::string changes;
+        serviceHandle.getConfigSince(0, &changes);
+        auto generation = json::parse(changes)["generation"].get<uint64_t>();
+
+        // both entries are in the same wave, the second one may be created
+        auto list = json::array({makeProvider("my_provider_a", "unknown_module"),
+                                 makeProvider("my_provider_b")});
+        auto pool = server.getMargoManager().getDefaultHandlerPool();
+        REQUIRE_THROWS_AS(providerManager.addProviderListFromJSON(list, pool),
+                          bedrock::Exception);
+        REQUIRE(providerManager.numProviders() == 0);
+        REQUIRE_THROWS_AS(providerManager.lookupProvider("my_provider_b"), bedrock::Exception);
+
+        serviceHandle.getConfigSince(generation, &changes);
+        auto c = json::parse(changes);
+        REQUIRE(c["unchanged"] == true);
+        REQUIRE(c["generation"] == generation);
+    }
+
+    server.finalize();
+}
+
+TEST_CASE("Tests provider lookup RPC with a timeout", "[provider-manager]") {
+
+    bedrock::Server server("na+sm", serverConfig);
+    auto engine = server.getMargoManager().getThalliumEngine();
+    auto providerManager = server.getProviderManager();
+
+    auto lookup = engine.define("bedrock_lookup_provider");
+    tl::provider_handle ph(engine.self(), 0);
+    using result_type = bedrock::RequestResult<bedrock::ProviderDescriptor>;
+
+    SECTION("Lookup returns when its deadline passes") {
+        auto t1 = tl::timer::wtime();
+        result_type result = lookup.on(ph)(std::string{"my_provider_a"}, 0.5);
+        auto t2 = tl::timer::wtime();
+        REQUIRE(!result.success());
+        REQUIRE(t2 - t1 >= 0.4);
+        REQUIRE(t2 - t1 < 5.0);
+    }
+
+    SECTION("Lookup returns when a matching provider is registered") {
+        auto t1 = tl::timer::wtime();
+        auto by_name = lookup.on(ph).async(std::string{"my_provider_a"}, 10.0);
+        auto by_id = lookup.on(ph).async(std::string{"module_a:0002"}, 10.0);
+        auto other = lookup.on(ph).async(std::string{"my_provider_c"}, 1.0);
+        tl::thread::sleep(engine, 100);
+        providerManager.addProviderFromJSON(makeProvider("my_provider_b", "module_b"));
+        providerManager.addProviderFromJSON(makeProvider("my_provider_a"));
+        result_type result_by_name = by_name.wait();
+        result_type result_by_id = by_id.wait();
+        auto t2 = tl::timer::wtime();
+        REQUIRE(result_by_name.success());
+        REQUIRE(result_by_name.value().name == "my_provider_a");
+        REQUIRE(result_by_id.success());
+        REQUIRE(result_by_id.value().name == "my_provider_a");
+        REQUIRE(t2 - t1 < 5.0);
+        result_type result_other = other.wait();
+        REQUIRE(!result_other.success());
+    }
+
+    SECTION("Batched lookups share the timeout") {
+        providerManager.addProviderFromJSON(makeProvider("my_provider_a"));
+        auto lookup_many = engine.define("bedrock_lookup_providers");
+        std::vector<std::string> specs = {"my_provider_a", "module_a:1", "my_provider_b", "my_provider_c"};
+        auto t1 = tl::timer::wtime();
+        std::vector<result_type> results = lookup_many.on(ph)(specs, 0.5);
+        auto t2 = tl::timer::wtime();
+        REQUIRE(results.size() == 4);
+        REQUIRE(results[0].success());
+        REQUIRE(results[0].value().provider_id == 1);
+        REQUIRE(results[1].success());
+        REQUIRE(results[1].value().name == "my_provider_a");
+        REQUIRE(!results[2].success());
+        REQUIRE(!results[3].success());
+        REQUIRE(t2 - t1 < 1.0);
+    }
+
+    server.finalize();
+}
+
+TEST_CASE("Tests provider lookups during a snapshot", "[provider-manager]") {
+
+    bedrock::Server server("na+sm",
+        R"({"libraries":["libModuleD.so"],"providers":[{"name":"slow","type":"module_d"}]})");
+    auto engine = server.getMargoManager().getThalliumEngine();
+    bedrock::Client client(engine);
+    auto serviceHandle = client.makeServiceHandle(engine.self(), 0);
+    auto providerManager = server.getProviderManager();
+
+    auto lookup = engine.define("bedrock_lookup_provider");
+    tl::provider_handle ph(engine.self(), 0);
+
+    // snapshot the provider asynchronously, then keep sending lookup
+    // RPCs and registering providers until the snapshot completes
+    const double snapshot_ms = 1000.0;
+    bedrock::AsyncRequest req;
+    serviceHandle.snapshotProvider(
+        "slow", "/tmp", json{{"duration_ms", snapshot_ms}}.dump(), false, &req);
+
+    size_t num_lookups = 0;
+    double max_latency_ms = 0.0;
+    auto t_start = tl::timer::wtime();
+    while(!req.completed()) {
+        auto t1 = tl::timer::wtime();
+        bedrock::RequestResult<bedrock::ProviderDescriptor> result =
+            lookup.on(ph)(std::string{num_lookups % 2 ? "slow" : "module_d:1"}, 0.0);
+        auto t2 = tl::timer::wtime();
+        REQUIRE(result.success());
+        REQUIRE(result.value().name == "slow");
+        max_latency_ms = std::max(max_latency_ms, (t2 - t1)*1000.0);
+        if(num_lookups % 16 == 0) {
+            providerManager.addProviderFromJSON(
+                json{{"name", "p" + std::to_string(num_lookups)}, {"type", "module_d"}});
+        }
+        num_lookups += 1;
+    }
+    auto t_end = tl::timer::wtime();
+    req.wait();
+
+    REQUIRE((t_end - t_start)*1000.0 >= snapshot_ms/2);
+    REQUIRE(num_lookups > 1);
+    REQUIRE(max_latency_ms < snapshot_ms/2);
+
+    server.finalize();
+}
+
+TEST_CASE("Benchmark provider registration and lookup", "[.benchmark][provider-manager]") {
+
+    for(size_t n : {10000, 20000, 30000, 40000, 50000, 60000}) {
+        bedrock::Server server("na+sm", serverConfig);
+        auto providerManager = server.getProviderManager();
+
+        std::vector<json> descriptions;
+        descriptions.reserve(n);
+        for(size_t i = 0; i < n; ++i)
+            descriptions.push_back(makeProvider("provider_" + std::to_string(i)));
+
+        auto t1 = std::chrono::steady_clock::now();
+        for(auto& description : descriptions)
+            providerManager.addProviderFromJSON(description);
+        auto t2 = std::chrono::steady_clock::now();
+        for(size_t i = 0; i < n; ++i) {
+            providerManager.lookupProvider("provider_" + std::to_string(i));
+            providerManager.lookupProvider("module_a:" + std::to_string(i + 1));
+        }
+        auto t3 = std::chrono::steady_clock::now();
+        REQUIRE(providerManager.numProviders() == n);
+
+        using us = std::chrono::duration<double, std::micro>;
+        std::cout << n << " providers: "
+                  << us(t2 - t1).count() / n << " us/registration, "
+                  << us(t3 - t2).count() / (2 * n) << " us/lookup" << std::endl;
+        server.finalize();
+    }
+}
@@ -0,0 +1,52 @@
+#include "Helpers.hpp"
+#include <nlohmann/json.hpp>
+
+/**
+ * Component whose snapshot, migrate and restore operations
+ * take the number of milliseconds specified in the "duration_ms"
+ * field of their configuration.
+ */
+class ComponentD : public bedrock::AbstractComponent {
+
+    using json = nlohmann::json;
+
+    std::unique_ptr<TestProvider> m_provider;
+
+    void sleepFor(const char* config) {
+        auto duration = json::parse(config).value("duration_ms", 0.0);
+        thallium::thread::sleep(m_provider->engine, duration);
+    }
+
+    public:
+
+    ComponentD(const bedrock::ComponentArgs& args)
+    : m_provider{std::make_unique<TestProvider>(args)} {}
+
+    void* getHandle() override {
+        return static_cast<void*>(m_provider.get());
+    }
+
+    void migrate(const char*, uint16_t, const char* options_json, bool) override {
+        sleepFor(options_json);
+    }
+
+    void snapshot(const char*, const char* options_json, bool) override {
+        sleepFor(options_json);
+    }
+
+    void restore(const char*, const char* options_json) override {
+        sleepFor(options_json);
+    }
+
+    static std::shared_ptr<bedrock::AbstractComponent>
+        Register(const bedrock::ComponentArgs& args) {
+            return std::make_shared<ComponentD>(args);
+        }
+
+    static std::vector<bedrock::Dependency>
+        GetDependencies(const bedrock::ComponentArgs&) {
+            return {};
+        }
+};
+
+BEDROCK_REGISTER_COMPONENT_TYPE(module_d, ComponentD)